@@ -0,0 +1,73 @@
+#include "bench_common.hpp"
+#include "color_utils.hpp"
+#include <cfloat>
+#include <random>
+
+using namespace std;
+using namespace cv;
+
+Mat syntheticImage(int width, int height, uint32_t seed) {
+  mt19937 rng(seed);
+  uniform_real_distribution<float> unit(0.0f, 1.0f);
+  normal_distribution<float> noise(0.0f, 4.0f);
+
+  struct Blob {
+    float x, y, radius;
+    Vec3f color;
+  };
+  vector<Blob> blobs;
+  for (int i = 0; i < 6; ++i)
+    blobs.push_back({unit(rng) * width, unit(rng) * height,
+                     (0.05f + 0.2f * unit(rng)) * min(width, height),
+                     Vec3f(unit(rng) * 255, unit(rng) * 255, unit(rng) * 255)});
+
+  Vec3f top(unit(rng) * 120, unit(rng) * 120, unit(rng) * 120);
+  Vec3f bottom(unit(rng) * 255, unit(rng) * 255, unit(rng) * 255);
+
+  Mat img(height, width, CV_8UC3);
+  for (int y = 0; y < height; ++y) {
+    float t = height > 1 ? float(y) / (height - 1) : 0.0f;
+    Vec3b *row = img.ptr<Vec3b>(y);
+    for (int x = 0; x < width; ++x) {
+      Vec3f c;
+      for (int ch = 0; ch < 3; ++ch)
+        c[ch] = top[ch] * (1 - t) + bottom[ch] * t;
+      for (const auto &b : blobs) {
+        float dx = x - b.x, dy = y - b.y;
+        if (dx * dx + dy * dy < b.radius * b.radius)
+          c = b.color;
+      }
+      for (int ch = 0; ch < 3; ++ch)
+        row[x][ch] = saturate_cast<uchar>(c[ch] + noise(rng));
+    }
+  }
+  return img;
+}
+
+Mat syntheticLab(int width, int height, uint32_t seed) {
+  Mat img;
+  syntheticImage(width, height, seed).convertTo(img, CV_32F, 1.0 / 255.0);
+  Mat lab;
+  cvtColor(img, lab, COLOR_BGR2Lab);
+  return lab;
+}
+
+static double directedDistance(const vector<Vec3f> &from,
+                               const vector<Vec3f> &to) {
+  if (from.empty())
+    return 0.0;
+  double total = 0.0;
+  for (const auto &c : from) {
+    float best = FLT_MAX;
+    for (const auto &d : to)
+      best = min(best, colorDistance(c, d));
+    total += best;
+  }
+  return total / from.size();
+}
+
+double paletteDistance(const vector<Vec3f> &a, const vector<Vec3f> &b) {
+  if (a.empty() || b.empty())
+    return a.empty() && b.empty() ? 0.0 : FLT_MAX;
+  return 0.5 * (directedDistance(a, b) + directedDistance(b, a));
+}
@@ -0,0 +1,47 @@
+#ifndef BENCH_COMMON_HPP
+#define BENCH_COMMON_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+// Best-of-`reps` wall time of `fn` in milliseconds.
+template <typename F> double timeMs(F &&fn, int reps = 5) {
+  double best = 1e300;
+  for (int i = 0; i < reps; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto end = std::chrono::steady_clock::now();
+    best = std::min(
+        best, std::chrono::duration<double, std::milli>(end - start).count());
+  }
+  return best;
+}
+
+// Deterministic wallpaper-like 8-bit BGR image: smooth gradients with a few
+// saturated blobs and mild noise.
+cv::Mat syntheticImage(int width, int height, uint32_t seed = 1);
+
+// syntheticImage() converted to float Lab the way the pipeline does it.
+cv::Mat syntheticLab(int width, int height, uint32_t seed = 1);
+
+// Symmetric mean nearest-neighbour Delta E 76 between two palettes; 0 when
+// every color of each palette also appears in the other.
+double paletteDistance(const std::vector<cv::Vec3f> &a,
+                       const std::vector<cv::Vec3f> &b);
+
+void benchClusterModes();
+void benchDistanceMetrics();
+void benchKMeansEngines();
+void benchLabFixed();
+void benchPreprocess();
+void benchRegions();
+void benchSeeded();
+void benchSerialize();
+void benchStages();
+void benchTiled();
+void benchVariants();
+
+#endif
@@ -0,0 +1,41 @@
+#include "bench_common.hpp"
+#include <functional>
+#include <iostream>
+#include <map>
+
+using namespace std;
+
+int main(int argc, char **argv) {
+  map<string, function<void()>> benches = {
+      {"cluster-modes", benchClusterModes},
+      {"distance-metrics", benchDistanceMetrics},
+      {"kmeans-engines", benchKMeansEngines},
+      {"lab-fixed", benchLabFixed},
+      {"preprocess", benchPreprocess},
+      {"regions", benchRegions},
+      {"seeded", benchSeeded},
+      {"serialize", benchSerialize},
+      {"stages", benchStages},
+      {"tiled", benchTiled},
+      {"variants", benchVariants},
+  };
+
+  if (argc > 1) {
+    auto it = benches.find(argv[1]);
+    if (it == benches.end()) {
+      cerr << "Unknown benchmark: " << argv[1] << "\nAvailable:";
+      for (const auto &b : benches)
+        cerr << " " << b.first;
+      cerr << "\n";
+      return 1;
+    }
+    it->second();
+    return 0;
+  }
+
+  for (const auto &b : benches) {
+    cout << "== " << b.first << " ==" << endl;
+    b.second();
+  }
+  return 0;
+}
@@ -0,0 +1,75 @@
+#include "bench_common.hpp"
+#include "kmeans_wrapper.hpp"
+#include <iostream>
+#include <map>
+
+using namespace std;
+using namespace cv;
+
+// The original per-cluster std::map scan, kept as the baseline.
+static vector<Vec3f> clusterModesMap(const Mat &lab, const Mat &labels,
+                                     int k) {
+  vector<Vec3f> allColors;
+  auto vec3fCompare = [](const Vec3f &a, const Vec3f &b) {
+    if (a[0] != b[0])
+      return a[0] < b[0];
+    if (a[1] != b[1])
+      return a[1] < b[1];
+    return a[2] < b[2];
+  };
+
+  for (int cluster = 0; cluster < k; ++cluster) {
+    map<Vec3f, int, decltype(vec3fCompare)> colorCount(vec3fCompare);
+    for (int i = 0; i < labels.rows; ++i) {
+      if (labels.at<int>(i, 0) == cluster) {
+        Vec3f labColor = lab.at<Vec3f>(i / lab.cols, i % lab.cols);
+        labColor[0] = round(labColor[0]);
+        labColor[1] = round(labColor[1] * 2) / 2.0f;
+        labColor[2] = round(labColor[2] * 2) / 2.0f;
+        colorCount[labColor]++;
+      }
+    }
+
+    Vec3f mostFrequent;
+    int maxCount = 0;
+    for (const auto &pair : colorCount) {
+      if (pair.second > maxCount) {
+        maxCount = pair.second;
+        mostFrequent = pair.first;
+      }
+    }
+    if (maxCount > 0)
+      allColors.push_back(mostFrequent);
+  }
+  return allColors;
+}
+
+void benchClusterModes() {
+  const int k = 32;
+  const Size sizes[] = {Size(200, 200), Size(1920, 1080), Size(3840, 2160)};
+
+  for (const Size &size : sizes) {
+    Mat lab = syntheticLab(size.width, size.height);
+    // Labels only need to be plausible: bucket by lightness and hue sign.
+    Mat labels(lab.rows * lab.cols, 1, CV_32S);
+    for (int i = 0; i < labels.rows; ++i) {
+      const Vec3f &c = lab.at<Vec3f>(i / lab.cols, i % lab.cols);
+      labels.at<int>(i, 0) =
+          (static_cast<int>(c[0]) / 13 * 4 + (c[1] > 0) * 2 + (c[2] > 0)) % k;
+    }
+
+    vector<Vec3f> expected, actual;
+    int reps = size.area() > 1000000 ? 1 : 5;
+    double mapMs =
+        timeMs([&] { expected = clusterModesMap(lab, labels, k); }, reps);
+    double flatMs = timeMs([&] { actual = clusterModes(lab, labels, k); });
+
+    bool same = expected.size() == actual.size();
+    for (size_t i = 0; same && i < expected.size(); ++i)
+      same = expected[i] == actual[i];
+
+    cout << size.width << "x" << size.height << ": map " << mapMs
+         << " ms, flat " << flatMs << " ms, speedup " << mapMs / flatMs
+         << "x, " << (same ? "identical" : "MISMATCH") << endl;
+  }
+}
@@ -0,0 +1,49 @@
+#include "bench_common.hpp"
+#include "color_distance.hpp"
+#include "color_selector.hpp"
+#include <iostream>
+#include <memory>
+#include <random>
+
+using namespace std;
+using namespace cv;
+
+static vector<Vec3f> randomLabColors(size_t count, uint32_t seed) {
+  mt19937 rng(seed);
+  uniform_real_distribution<float> lightness(30.0f, 95.0f);
+  uniform_real_distribution<float> chroma(-80.0f, 80.0f);
+  vector<Vec3f> colors(count);
+  for (Vec3f &c : colors)
+    c = Vec3f(lightness(rng), chroma(rng), chroma(rng));
+  return colors;
+}
+
+// Cost of each metric at typical candidate counts: building the distance
+// matrix, then selecting 16 colors from it, against the direct CIE76 path.
+void benchDistanceMetrics() {
+  const size_t counts[] = {32, 128, 512};
+  const DistanceMetric metrics[] = {DistanceMetric::CIE76,
+                                    DistanceMetric::CIEDE2000,
+                                    DistanceMetric::CAM16UCS};
+
+  for (size_t count : counts) {
+    vector<Vec3f> colors = randomLabColors(count, 7);
+    vector<Vec3f> direct;
+    double directMs =
+        timeMs([&] { direct = selectMostDistinctColors(colors, 16); });
+    cout << count << " candidates: direct cie76 select " << directMs << " ms";
+
+    for (DistanceMetric metric : metrics) {
+      unique_ptr<DistanceMatrix> matrix;
+      double buildMs = timeMs(
+          [&] { matrix.reset(new DistanceMatrix(colors, metric)); }, 3);
+      vector<Vec3f> picks;
+      double selectMs = timeMs(
+          [&] { picks = selectMostDistinctColors(colors, 16, *matrix); });
+      cout << "; " << distanceMetricName(metric) << " matrix " << buildMs
+           << " ms, select " << selectMs << " ms, dE76 vs direct "
+           << paletteDistance(direct, picks);
+    }
+    cout << endl;
+  }
+}
@@ -0,0 +1,73 @@
+#include "bench_common.hpp"
+#include "color_selector.hpp"
+#include "kmeans_wrapper.hpp"
+#include "minibatch_kmeans.hpp"
+#include <iostream>
+
+using namespace std;
+using namespace cv;
+
+static vector<Vec3f> selectPalette(const vector<Vec3f> &clusterColors) {
+  vector<Vec3f> filtered;
+  for (const auto &c : clusterColors) {
+    if (c[0] > 30.0f)
+      filtered.push_back(c);
+  }
+  return selectMostDistinctColors(filtered, 16);
+}
+
+static vector<Vec3f> opencvPalette(const Mat &lab, int k, uint64_t seed) {
+  theRNG().state = seed;
+  Mat samples = lab.reshape(1, lab.rows * lab.cols);
+  Mat labels, centers;
+  kmeans(samples, k, labels,
+         TermCriteria(TermCriteria::EPS + TermCriteria::COUNT, 10, 1.0), 3,
+         KMEANS_PP_CENTERS, centers);
+  return selectPalette(clusterModes(lab, labels, k));
+}
+
+static vector<Vec3f> miniBatchPalette(const Mat &lab, int k, uint32_t seed) {
+  MiniBatchParams params;
+  params.seed = seed;
+  KMeansResult result = miniBatchKMeans(LabSoA::fromMat(lab), k, params);
+  Mat labels(static_cast<int>(result.labels.size()), 1, CV_32S,
+             result.labels.data());
+  return selectPalette(clusterModes(lab, labels, k));
+}
+
+// Wall time per engine plus palette stability: the mean Delta E between the
+// palette of each reseeded run and the first run (lower is more stable).
+void benchKMeansEngines() {
+  const int k = 32;
+  const int runs = 5;
+  const Size sizes[] = {Size(200, 200), Size(960, 540), Size(1920, 1080)};
+
+  for (const Size &size : sizes) {
+    Mat lab = syntheticLab(size.width, size.height);
+    int reps = size.area() > 500000 ? 1 : 3;
+
+    vector<vector<Vec3f>> cvRuns, mbRuns;
+    double cvMs = 0, mbMs = 0;
+    for (int r = 0; r < runs; ++r) {
+      vector<Vec3f> palette;
+      cvMs += timeMs([&] { palette = opencvPalette(lab, k, 1234 + r); }, reps);
+      cvRuns.push_back(palette);
+      mbMs += timeMs([&] { palette = miniBatchPalette(lab, k, 1234 + r); },
+                     reps);
+      mbRuns.push_back(palette);
+    }
+
+    double cvDrift = 0, mbDrift = 0, crossDelta = 0;
+    for (int r = 1; r < runs; ++r) {
+      cvDrift += paletteDistance(cvRuns[0], cvRuns[r]) / (runs - 1);
+      mbDrift += paletteDistance(mbRuns[0], mbRuns[r]) / (runs - 1);
+    }
+    for (int r = 0; r < runs; ++r)
+      crossDelta += paletteDistance(cvRuns[r], mbRuns[r]) / runs;
+
+    cout << size.width << "x" << size.height << ": opencv " << cvMs / runs
+         << " ms (drift dE " << cvDrift << "), minibatch " << mbMs / runs
+         << " ms (drift dE " << mbDrift << "), speedup " << cvMs / mbMs
+         << "x, engines differ by dE " << crossDelta << endl;
+  }
+}
@@ -0,0 +1,61 @@
+#include "bench_common.hpp"
+#include "lab_fixed.hpp"
+#include "pipeline.hpp"
+#include <iostream>
+
+using namespace std;
+using namespace cv;
+
+// Float vs fixed-point Lab: conversion time, working-set bytes per pixel,
+// per-pixel conversion error, and end-to-end palette time and Delta E.
+void benchLabFixed() {
+  const Size sizes[] = {Size(200, 200), Size(960, 540), Size(1920, 1080)};
+
+  for (const Size &size : sizes) {
+    Mat bgr = syntheticImage(size.width, size.height);
+
+    Mat floatLab;
+    double floatMs = timeMs([&] {
+      Mat img;
+      bgr.convertTo(img, CV_32F, 1.0 / 255.0);
+      cvtColor(img, floatLab, COLOR_BGR2Lab);
+    });
+    LabFixedSoA fixedLab;
+    double fixedMs = timeMs([&] { fixedLab = bgrToLabFixed(bgr); });
+
+    double sumError = 0, maxError = 0;
+    size_t i = 0;
+    for (int row = 0; row < floatLab.rows; ++row) {
+      const Vec3f *pixel = floatLab.ptr<Vec3f>(row);
+      for (int col = 0; col < floatLab.cols; ++col, ++i) {
+        Vec3s fixed(fixedLab.l[i], fixedLab.a[i], fixedLab.b[i]);
+        Vec3f d = pixel[col] - labFixedToFloat(fixed);
+        double e = sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+        sumError += e;
+        maxError = max(maxError, e);
+      }
+    }
+
+    // Float BGR copy plus float Lab, against int16 Lab.
+    size_t floatBytes = 2 * sizeof(Vec3f);
+    size_t fixedBytes = 3 * sizeof(int16_t);
+
+    ExtractOptions opts;
+    opts.pixelBudget = size.area();
+    opts.engine = ClusterEngine::MiniBatch;
+    vector<Vec3f> floatPalette, fixedPalette;
+    double floatPaletteMs =
+        timeMs([&] { floatPalette = extractPalette(bgr, opts); }, 3);
+    opts.fixedPoint = true;
+    double fixedPaletteMs =
+        timeMs([&] { fixedPalette = extractPalette(bgr, opts); }, 3);
+
+    cout << size.width << "x" << size.height << ": convert float "
+         << floatMs << " ms (" << floatBytes << " B/px), fixed " << fixedMs
+         << " ms (" << fixedBytes << " B/px), pixel dE mean "
+         << sumError / i << " max " << maxError << "; palette float "
+         << floatPaletteMs << " ms, fixed " << fixedPaletteMs
+         << " ms, palette dE " << paletteDistance(floatPalette, fixedPalette)
+         << endl;
+  }
+}
@@ -0,0 +1,37 @@
+#include "bench_common.hpp"
+#include "preprocess.hpp"
+#include <filesystem>
+#include <iostream>
+
+using namespace std;
+using namespace cv;
+namespace fs = std::filesystem;
+
+// Decode + shrink cost of the old fixed 200x200 bilinear resize against the
+// budgeted loader (decode-time JPEG reduction + INTER_AREA), per format.
+void benchPreprocess() {
+  const long budget = 200 * 200;
+  const Size sizes[] = {Size(1920, 1080), Size(3840, 2160), Size(5120, 2880),
+                        Size(7680, 4320)};
+  fs::path dir = fs::temp_directory_path() / "huegen-bench";
+  fs::create_directories(dir);
+
+  for (const Size &size : sizes) {
+    Mat img = syntheticImage(size.width, size.height);
+    for (const string ext : {".jpg", ".png"}) {
+      string path = (dir / (to_string(size.width) + ext)).string();
+      imwrite(path, img);
+
+      Mat before, after;
+      double beforeMs = timeMs(
+          [&] { resize(imread(path), before, Size(200, 200)); }, 3);
+      double afterMs = timeMs([&] { after = loadImage(path, budget); }, 3);
+
+      cout << size.width << "x" << size.height << " " << ext.substr(1)
+           << ": imread+resize " << beforeMs << " ms, loadImage " << afterMs
+           << " ms (" << after.cols << "x" << after.rows << "), speedup "
+           << beforeMs / afterMs << "x" << endl;
+      fs::remove(path);
+    }
+  }
+}
@@ -0,0 +1,50 @@
+#include "bench_common.hpp"
+#include "pipeline.hpp"
+#include <iostream>
+
+using namespace std;
+using namespace cv;
+
+// Region palettes from one clustering pass against clustering every crop
+// separately, and the mean Delta E between the two region palettes.
+void benchRegions() {
+  const Size sizes[] = {Size(1920, 1080), Size(3840, 2160)};
+  const vector<Region> &regions = defaultRegions();
+
+  for (const Size &size : sizes) {
+    Mat img = syntheticImage(size.width, size.height);
+    ExtractOptions opts;
+    opts.engine = ClusterEngine::MiniBatch;
+
+    double wholeMs = timeMs([&] { extractPalette(img, opts); }, 3);
+
+    opts.regions = regions;
+    vector<RegionPalette> shared;
+    double sharedMs =
+        timeMs([&] { extractRegionPalettes(img, opts, shared); }, 3);
+
+    opts.regions.clear();
+    vector<vector<Vec3f>> crops(regions.size());
+    double cropMs = timeMs(
+        [&] {
+          for (size_t i = 0; i < regions.size(); ++i) {
+            const Region &r = regions[i];
+            Rect rect(static_cast<int>(r.x * img.cols),
+                      static_cast<int>(r.y * img.rows),
+                      static_cast<int>(r.width * img.cols),
+                      static_cast<int>(r.height * img.rows));
+            crops[i] = extractPalette(img(rect), opts);
+          }
+        },
+        3);
+
+    double delta = 0;
+    for (size_t i = 0; i < regions.size(); ++i)
+      delta += paletteDistance(shared[i].colors, crops[i]) / regions.size();
+
+    cout << size.width << "x" << size.height << ": whole image " << wholeMs
+         << " ms, whole + " << regions.size() << " regions " << sharedMs
+         << " ms, per-crop clustering " << wholeMs + cropMs
+         << " ms, region palettes differ by dE " << delta << endl;
+  }
+}
@@ -0,0 +1,53 @@
+#include "bench_common.hpp"
+#include "kmeans_wrapper.hpp"
+#include <iostream>
+
+using namespace std;
+using namespace cv;
+
+// Seeded engine against cv::kmeans: time, iterations to convergence, whether
+// repeated runs with one seed are identical, and the palette drift between
+// seeds.
+void benchSeeded() {
+  const int k = 32;
+  const int seeds = 5;
+  const Size sizes[] = {Size(200, 200), Size(960, 540), Size(1920, 1080)};
+
+  for (const Size &size : sizes) {
+    Mat lab = syntheticLab(size.width, size.height);
+    int reps = size.area() > 500000 ? 1 : 3;
+
+    double cvMs = timeMs(
+        [&] { extractClusterColors(lab, k, ClusterEngine::OpenCV); }, reps);
+
+    vector<vector<Vec3f>> runs;
+    double seededMs = 0, iterations = 0;
+    for (int s = 0; s < seeds; ++s) {
+      vector<Vec3f> colors;
+      ClusterStats stats;
+      seededMs += timeMs(
+          [&] {
+            colors = extractClusterColors(lab, k, ClusterEngine::Seeded,
+                                          1234 + s, &stats);
+          },
+          reps);
+      iterations += stats.iterations;
+      runs.push_back(colors);
+    }
+
+    bool repeatable = true;
+    for (int r = 0; r < 3; ++r)
+      repeatable = repeatable &&
+                   extractClusterColors(lab, k, ClusterEngine::Seeded,
+                                        1234) == runs[0];
+    double drift = 0;
+    for (int s = 1; s < seeds; ++s)
+      drift += paletteDistance(runs[0], runs[s]) / (seeds - 1);
+
+    cout << size.width << "x" << size.height << ": opencv " << cvMs
+         << " ms, seeded " << seededMs / seeds << " ms ("
+         << iterations / seeds << " iterations, "
+         << (repeatable ? "repeatable" : "NOT repeatable")
+         << ", seed drift dE " << drift << ")" << endl;
+  }
+}
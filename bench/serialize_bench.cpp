@@ -0,0 +1,82 @@
+#include "bench_common.hpp"
+#include "template_engine.hpp"
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+using namespace std;
+using namespace cv;
+
+// The original per-color serializer: a 1x1 cvtColor per color, stringstream
+// hex formatting and to_string concatenation. Kept as the baseline.
+static json colorsToJsonPerColor(const vector<Vec3f> &labColors) {
+  json result = json::object();
+  for (size_t i = 0; i < labColors.size(); ++i) {
+    const Vec3f &labColor = labColors[i];
+    Mat lab(1, 1, CV_32FC3, Scalar(labColor[0], labColor[1], labColor[2]));
+    Mat bgr;
+    cvtColor(lab, bgr, COLOR_Lab2BGR);
+    bgr.convertTo(bgr, CV_8UC3, 255.0);
+    Vec3b rgbColor = bgrToRgb(bgr.at<Vec3b>(0, 0));
+    Vec3f hslColor = rgbToHsl(rgbColor);
+    Vec3f hsvColor = rgbToHsv(rgbColor);
+
+    stringstream hexStream;
+    hexStream << hex << uppercase << setfill('0') << setw(2)
+              << (int)rgbColor[0] << setw(2) << (int)rgbColor[1] << setw(2)
+              << (int)rgbColor[2];
+    string stripped = hexStream.str();
+    string rgb = to_string(rgbColor[0]) + ", " + to_string(rgbColor[1]) +
+                 ", " + to_string(rgbColor[2]);
+
+    result["color" + to_string(i)] = {
+        {"hex", "#" + stripped},
+        {"strip", stripped},
+        {"rgb", "rgb(" + rgb + ")"},
+        {"rgba", "rgba(" + rgb + ", 1.0)"},
+        {"hsl", "hsl(" + to_string((int)round(hslColor[0])) + ", " +
+                    to_string((int)round(hslColor[1])) + "%, " +
+                    to_string((int)round(hslColor[2])) + "%)"},
+        {"hsv", "hsv(" + to_string((int)round(hsvColor[0])) + ", " +
+                    to_string((int)round(hsvColor[1])) + "%, " +
+                    to_string((int)round(hsvColor[2])) + "%)"},
+        {"lab", "lab(" + to_string((int)round(labColor[0])) + ", " +
+                    to_string((int)round(labColor[1])) + ", " +
+                    to_string((int)round(labColor[2])) + ")"}};
+  }
+  return result;
+}
+
+// Serialization cost of many 16-color palettes, as produced by batch mode.
+void benchSerialize() {
+  const int palettes = 2000;
+  const int colors = 16;
+
+  mt19937 rng(7);
+  uniform_real_distribution<float> lightness(30.0f, 95.0f);
+  uniform_real_distribution<float> chroma(-80.0f, 80.0f);
+  vector<vector<Vec3f>> inputs(palettes);
+  for (auto &palette : inputs)
+    for (int i = 0; i < colors; ++i)
+      palette.push_back(Vec3f(lightness(rng), chroma(rng), chroma(rng)));
+
+  bool same = true;
+  for (int p = 0; same && p < palettes; p += 97)
+    same = colorsToJsonPerColor(inputs[p]) == colorsToJson(inputs[p]);
+
+  size_t sink = 0;
+  double perColorMs = timeMs([&] {
+    for (const auto &palette : inputs)
+      sink += colorsToJsonPerColor(palette).size();
+  });
+  double batchedMs = timeMs([&] {
+    for (const auto &palette : inputs)
+      sink += colorsToJson(palette).size();
+  });
+
+  cout << palettes << " palettes x " << colors << " colors: per-color "
+       << perColorMs << " ms, batched " << batchedMs << " ms, speedup "
+       << perColorMs / batchedMs << "x, "
+       << (same ? "identical" : "MISMATCH") << " (" << sink << ")" << endl;
+}
@@ -0,0 +1,95 @@
+#include "bench_common.hpp"
+#include "color_selector.hpp"
+#include "histogram_clustering.hpp"
+#include "kmeans_wrapper.hpp"
+#include "preprocess.hpp"
+#include "profiler.hpp"
+#include "template_engine.hpp"
+#include <filesystem>
+#include <iostream>
+#include <nlohmann/json.hpp>
+
+using namespace std;
+using namespace cv;
+namespace fs = std::filesystem;
+
+#ifndef HUEGEN_SOURCE_DIR
+#define HUEGEN_SOURCE_DIR "."
+#endif
+
+// Increment when the meaning of a field changes so stored results from older
+// releases are not compared against incompatible ones.
+static const int stageBenchSchema = 1;
+
+template <typename F>
+static void measure(const string &stage, const Size &size, F &&fn,
+                    int reps = 3) {
+  profiler::AllocStats before = profiler::allocations();
+  fn();
+  profiler::AllocStats after = profiler::allocations();
+  double ms = timeMs(fn, reps);
+
+  nlohmann::json record = {{"schema", stageBenchSchema},
+                           {"stage", stage},
+                           {"width", size.width},
+                           {"height", size.height},
+                           {"ms", ms},
+                           {"allocs", after.count - before.count},
+                           {"alloc_bytes", after.bytes - before.bytes}};
+  cout << record.dump() << endl;
+}
+
+// Every pipeline stage over synthetic wallpapers at several resolutions,
+// one JSON object per line so results can be diffed across releases.
+void benchStages() {
+  const Size sizes[] = {Size(640, 360), Size(1920, 1080), Size(3840, 2160),
+                        Size(7680, 4320)};
+  const long budget = 200 * 200;
+  fs::path dir = fs::temp_directory_path() / "huegen-bench";
+  fs::create_directories(dir / "themes");
+  string templateDir = string(HUEGEN_SOURCE_DIR) + "/templates";
+
+  for (const Size &size : sizes) {
+    Mat image = syntheticImage(size.width, size.height);
+    string path = (dir / "stage.jpg").string();
+    imwrite(path, image);
+
+    Mat decoded, small, lab;
+    vector<Vec3f> clusters, palette;
+    nlohmann::json colorJson;
+
+    measure("imread", size, [&] { decoded = imread(path); });
+    measure("imread_reduced", size, [&] { decoded = loadImage(path, budget); });
+    measure("resize", size,
+            [&] { small = downsampleToBudget(image, budget); });
+    measure("cvtColor", size, [&] {
+      Mat img;
+      small.convertTo(img, CV_32F, 1.0 / 255.0);
+      cvtColor(img, lab, COLOR_BGR2Lab);
+    });
+    measure("extractClusterColors", size,
+            [&] { clusters = extractClusterColors(lab, 32); });
+    measure("extractClusterColors_minibatch", size, [&] {
+      extractClusterColors(lab, 32, ClusterEngine::MiniBatch);
+    });
+    measure("extractHistogramColors", size,
+            [&] { extractHistogramColors(image, 32); });
+    measure("selectMostDistinctColors", size, [&] {
+      vector<Vec3f> filtered;
+      for (const auto &c : clusters) {
+        if (c[0] > 30.0f)
+          filtered.push_back(c);
+      }
+      palette = selectMostDistinctColors(filtered, 16);
+    });
+    measure("colorsToJson", size, [&] { colorJson = colorsToJson(palette); });
+    measure("processTemplates", size, [&] {
+      // Keep the per-file progress lines out of the JSON output.
+      streambuf *out = cout.rdbuf(nullptr);
+      processTemplates(colorJson, templateDir, (dir / "themes").string());
+      cout.rdbuf(out);
+    });
+  }
+
+  fs::remove_all(dir);
+}
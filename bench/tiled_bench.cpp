@@ -0,0 +1,35 @@
+#include "bench_common.hpp"
+#include "thread_pool.hpp"
+#include "tiled_pipeline.hpp"
+#include <iostream>
+
+using namespace std;
+using namespace cv;
+
+// Thread scaling of the tiled full-resolution pass, and how far its palette
+// is from the single-threaded one (it should be identical).
+void benchTiled() {
+  const Size sizes[] = {Size(3840, 2160), Size(7680, 4320)};
+  unsigned cores = ThreadPool::shared().size();
+
+  for (const Size &size : sizes) {
+    Mat img = syntheticImage(size.width, size.height);
+    TileParams params;
+    params.threads = 1;
+    vector<Vec3f> reference;
+    double singleMs =
+        timeMs([&] { reference = extractTiledColors(img, 32, params); }, 2);
+    cout << size.width << "x" << size.height << ": 1 thread " << singleMs
+         << " ms" << endl;
+
+    for (unsigned threads = 2; threads <= cores; threads *= 2) {
+      params.threads = threads;
+      vector<Vec3f> colors;
+      double ms =
+          timeMs([&] { colors = extractTiledColors(img, 32, params); }, 2);
+      cout << "  " << threads << " threads " << ms << " ms, speedup "
+           << singleMs / ms << "x, palette distance "
+           << paletteDistance(reference, colors) << endl;
+    }
+  }
+}
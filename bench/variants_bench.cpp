@@ -0,0 +1,48 @@
+#include "bench_common.hpp"
+#include "pipeline.hpp"
+#include <algorithm>
+#include <iostream>
+
+using namespace std;
+using namespace cv;
+
+// Every default variant from one clustering pass against running the whole
+// pipeline once per variant, per metric.
+void benchVariants() {
+  const DistanceMetric metrics[] = {DistanceMetric::CIE76,
+                                    DistanceMetric::CIEDE2000};
+  const vector<PaletteVariant> &variants = defaultVariants();
+  Mat img = syntheticImage(1920, 1080);
+
+  for (DistanceMetric metric : metrics) {
+    ExtractOptions opts;
+    opts.engine = ClusterEngine::MiniBatch;
+    opts.metric = metric;
+
+    double wholeMs = timeMs([&] { extractPalette(img, opts); }, 3);
+
+    opts.variants = variants;
+    vector<VariantPalette> shared;
+    double sharedMs =
+        timeMs([&] { extractVariantPalettes(img, opts, shared); }, 3);
+
+    // Closest a plain run gets to each variant: its size and lower bound.
+    opts.variants.clear();
+    double separateMs = timeMs(
+        [&] {
+          for (const PaletteVariant &variant : variants) {
+            ExtractOptions single = opts;
+            single.clusters = max(opts.clusters, variant.colors);
+            single.minLightness = variant.minLightness;
+            single.colors = variant.colors;
+            extractPalette(img, single);
+          }
+        },
+        3);
+
+    cout << distanceMetricName(metric) << ": main palette " << wholeMs
+         << " ms, main + " << variants.size() << " variants " << sharedMs
+         << " ms, one run per variant " << wholeMs + separateMs << " ms"
+         << endl;
+  }
+}
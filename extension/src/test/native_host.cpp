@@ -1,10 +1,25 @@
 // native_host_example.cpp
-#include <fstream>
+//
+// Long-lived native messaging host. It maps the binary palette
+// (~/.config/huegen/themes/colors.bin) once, pushes it to the extension on
+// connect and again whenever its generation counter changes. Any message
+// from the extension (e.g. {"cmd": "get_palette"}) is answered with the
+// current palette. The host exits when the browser closes the port.
+#include "palette_file.hpp"
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
 #include <nlohmann/json.hpp>
+#include <poll.h>
 #include <string>
+#include <unistd.h>
 using json = nlohmann::json;
 
+// How often the generation counter is checked, in milliseconds.
+const int poll_interval_ms = 250;
+
 void send_message(const std::string &msg) {
   uint32_t len = (uint32_t)msg.size();
   std::cout.write(reinterpret_cast<const char *>(&len), 4);
@@ -12,24 +27,97 @@ void send_message(const std::string &msg) {
   std::cout.flush();
 }
 
+static bool read_exact(char *data, size_t size) {
+  while (size > 0) {
+    ssize_t n = read(STDIN_FILENO, data, size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    data += n;
+    size -= (size_t)n;
+  }
+  return true;
+}
+
+// Reads one length-prefixed message. False once the browser closes stdin.
+static bool read_message(std::string &msg) {
+  uint32_t len;
+  if (!read_exact(reinterpret_cast<char *>(&len), 4) || len > (1u << 20))
+    return false;
+  msg.resize(len);
+  return read_exact(&msg[0], len);
+}
+
+static std::string format(const char *fmt, int x, int y, int z) {
+  char buffer[64];
+  snprintf(buffer, sizeof(buffer), fmt, x, y, z);
+  return buffer;
+}
+
+static int rounded(float value) { return (int)std::round(value); }
+
+// Same shape and strings as colors.json.
+static json palette_message(const PaletteSnapshot &snapshot) {
+  json palette = json::object();
+  for (int i = 0; i < snapshot.count; ++i) {
+    const PaletteFileEntry &e = snapshot.entries[i];
+    int r = e.rgb[0], g = e.rgb[1], b = e.rgb[2];
+    std::string strip = format("%02X%02X%02X", r, g, b);
+    palette["color" + std::to_string(i)] = {
+        {"hex", "#" + strip},
+        {"strip", strip},
+        {"rgb", format("rgb(%d, %d, %d)", r, g, b)},
+        {"rgba", format("rgba(%d, %d, %d, 1.0)", r, g, b)},
+        {"hsl", format("hsl(%d, %d%%, %d%%)", rounded(e.hsl[0]),
+                       rounded(e.hsl[1]), rounded(e.hsl[2]))},
+        {"hsv", format("hsv(%d, %d%%, %d%%)", rounded(e.hsv[0]),
+                       rounded(e.hsv[1]), rounded(e.hsv[2]))},
+        {"lab", format("lab(%d, %d, %d)", rounded(e.lab[0]),
+                       rounded(e.lab[1]), rounded(e.lab[2]))}};
+  }
+  return palette;
+}
+
 int main() {
   std::string home = std::getenv("HOME") ? std::getenv("HOME") : ".";
-  std::string path = home + "/.config/huegen/themes/colors.json";
+  std::string path = home + "/.config/huegen/themes/colors.bin";
 
-  std::ifstream ifs(path);
-  if (!ifs.is_open()) {
-    send_message(R"({})");
-    return 0;
-  }
+  PaletteFileReader reader;
+  bool sent_any = false;
+  uint64_t sent_generation = 0;
 
-  json palette;
-  try {
-    ifs >> palette;
-  } catch (...) {
-    send_message(R"({})");
-    return 0;
-  }
+  // Sends the palette if it changed since the last message, or always when
+  // `force` is set (an empty object if there is no palette yet).
+  auto send_palette = [&](bool force) {
+    PaletteSnapshot snapshot;
+    if ((!reader.isOpen() && !reader.open(path)) || !reader.read(snapshot)) {
+      if (force)
+        send_message(R"({})");
+      return;
+    }
+    if (!force && sent_any && snapshot.generation == sent_generation)
+      return;
+    send_message(palette_message(snapshot).dump());
+    sent_any = true;
+    sent_generation = snapshot.generation;
+  };
 
-  send_message(palette.dump());
+  send_palette(true);
+  while (true) {
+    pollfd pfd = {STDIN_FILENO, POLLIN, 0};
+    int ready = poll(&pfd, 1, poll_interval_ms);
+    if (ready < 0 && errno != EINTR)
+      break;
+    if (ready > 0) {
+      std::string request;
+      if (!read_message(request))
+        break;
+      send_palette(true);
+    } else if (ready == 0 &&
+               (!reader.isOpen() || reader.generation() != sent_generation)) {
+      send_palette(false);
+    }
+  }
   return 0;
 }
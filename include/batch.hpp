@@ -0,0 +1,37 @@
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+#include "palette_cache.hpp"
+#include "pipeline.hpp"
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct BatchReport {
+  size_t processed = 0;
+  size_t failed = 0;
+  double seconds = 0.0;
+};
+
+// Expands `source` into a list of image paths. A directory is scanned for
+// image files; any other file is read as a list with one path per line.
+std::vector<std::string> collectBatchInputs(const std::string &source);
+
+// Extracts a palette for every input on up to `jobs` workers of the shared
+// pool (0 = one per core) and writes `<outputDir>/<filename>.json` for each
+// image; repeated file names get a "-2", "-3"... suffix. Palettes are read
+// from and stored to `cache` when one is given.
+BatchReport runBatch(const std::vector<std::string> &inputs,
+                     const std::string &outputDir, const ExtractOptions &opts,
+                     unsigned jobs = 0, PaletteCache *cache = nullptr);
+
+// Contact-sheet variant of runBatch: instead of one file per image, appends
+// one compact JSON line per image to `out` as soon as it completes, in
+// completion order: {"path": ..., "colors": ["#rrggbb", ...]}, or
+// {"path": ..., "error": ...} for images that fail. Only the in-flight
+// images are held in memory.
+BatchReport runBatchStream(const std::vector<std::string> &inputs,
+                           std::ostream &out, const ExtractOptions &opts,
+                           unsigned jobs = 0, PaletteCache *cache = nullptr);
+
+#endif
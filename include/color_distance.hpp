@@ -0,0 +1,43 @@
+#ifndef COLOR_DISTANCE_HPP
+#define COLOR_DISTANCE_HPP
+
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+// CIE76: Euclidean distance in Lab (colorDistance()).
+// CIEDE2000: CIE's current color-difference formula, with hue and chroma
+// weighting; trig-heavy.
+// CAM16-UCS: Euclidean distance after converting Lab to the CAM16 uniform
+// color space (sRGB viewing conditions); the per-color transform runs once.
+enum class DistanceMetric { CIE76, CIEDE2000, CAM16UCS };
+
+bool parseDistanceMetric(const std::string &name, DistanceMetric &metric);
+const char *distanceMetricName(DistanceMetric metric);
+
+// Single CIEDE2000 difference (kL = kC = kH = 1).
+float ciede2000(const cv::Vec3f &lab1, const cv::Vec3f &lab2);
+
+// CAM16-UCS (J', a', b') of a Lab color under D65, La = 64 / pi / 5 cd/m2,
+// Yb = 20 and an average surround.
+cv::Vec3f labToCam16Ucs(const cv::Vec3f &lab);
+
+// Symmetric candidate x candidate distance matrix, computed once so
+// selections over the same candidates (e.g. palettes of several sizes) only
+// read from it instead of re-evaluating the metric.
+class DistanceMatrix {
+public:
+  DistanceMatrix(const std::vector<cv::Vec3f> &colors, DistanceMetric metric);
+
+  size_t size() const { return size_; }
+  DistanceMetric metric() const { return metric_; }
+  const float *row(size_t i) const { return distances_.data() + i * size_; }
+  float operator()(size_t i, size_t j) const { return row(i)[j]; }
+
+private:
+  size_t size_;
+  DistanceMetric metric_;
+  std::vector<float> distances_;
+};
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef COLOR_HISTOGRAM_HPP
+#define COLOR_HISTOGRAM_HPP
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+// Quantized Lab value packed so that integer order matches (L, a, b)
+// lexicographic order: L to 1 unit, a and b to 0.5 units, 11 bits each.
+const int labQuantOffset = 1024;
+
+inline uint64_t quantizeLab(const cv::Vec3f &c) {
+  int l = static_cast<int>(std::round(c[0])) + labQuantOffset;
+  int a = static_cast<int>(std::round(c[1] * 2)) + labQuantOffset;
+  int b = static_cast<int>(std::round(c[2] * 2)) + labQuantOffset;
+  return (static_cast<uint64_t>(l) << 22) | (static_cast<uint64_t>(a) << 11) |
+         static_cast<uint64_t>(b);
+}
+
+inline cv::Vec3f dequantizeLab(uint64_t code) {
+  int l = static_cast<int>((code >> 22) & 0x7ff) - labQuantOffset;
+  int a = static_cast<int>((code >> 11) & 0x7ff) - labQuantOffset;
+  int b = static_cast<int>(code & 0x7ff) - labQuantOffset;
+  return cv::Vec3f(static_cast<float>(l), a / 2.0f, b / 2.0f);
+}
+
+// Key of a quantized color within a cluster: the cluster index sits above
+// the 33 bits of quantizeLab().
+inline uint64_t clusterColorKey(int cluster, uint64_t code) {
+  return (static_cast<uint64_t>(cluster) << 40) | code;
+}
+
+// Open-addressing (cluster, color) -> count table. Keys live in one flat
+// array so a pass over the pixels never allocates per entry.
+class ColorHistogram {
+public:
+  explicit ColorHistogram(size_t expected = 0);
+
+  void add(uint64_t key, int count = 1);
+
+  // Adds every entry of `other`. Partial histograms built by separate
+  // workers are combined this way once they are done, without locking.
+  void merge(const ColorHistogram &other);
+
+  template <typename F> void forEach(F &&f) const {
+    for (size_t i = 0; i < keys_.size(); ++i) {
+      if (keys_[i] != emptySlot)
+        f(keys_[i], counts_[i]);
+    }
+  }
+
+private:
+  static constexpr uint64_t emptySlot = UINT64_MAX;
+
+  static size_t slotFor(uint64_t key, size_t mask) {
+    return static_cast<size_t>((key * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+  }
+
+  void grow();
+
+  std::vector<uint64_t> keys_;
+  std::vector<int> counts_;
+  size_t size_ = 0;
+};
+
+// Most frequent color of each of the `k` clusters in `histogram`, ties going
+// to the smallest (L, a, b). Empty clusters are skipped.
+std::vector<cv::Vec3f> histogramModes(const ColorHistogram &histogram, int k);
+
+#endif
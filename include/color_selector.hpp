@@ -1,10 +1,25 @@
 #ifndef COLOR_SELECTOR_HPP
 #define COLOR_SELECTOR_HPP
 
+#include "color_distance.hpp"
 #include <opencv2/opencv.hpp>
 #include <vector>
 
 std::vector<cv::Vec3f>
 selectMostDistinctColors(const std::vector<cv::Vec3f> &colors, int n);
 
+// Same selection under a precomputed metric; `distances` must be built from
+// `colors`. One matrix can serve several selections of different sizes.
+std::vector<cv::Vec3f>
+selectMostDistinctColors(const std::vector<cv::Vec3f> &colors, int n,
+                         const DistanceMatrix &distances);
+
+// Selection among `subset` (ascending indices into the colors `distances`
+// was built from), so palettes that filter the same candidates differently
+// share one matrix. Returns the picked indices in selection order.
+std::vector<size_t>
+selectMostDistinctIndices(const std::vector<cv::Vec3f> &colors,
+                          const std::vector<size_t> &subset, int n,
+                          const DistanceMatrix &distances);
+
 #endif
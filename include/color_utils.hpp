@@ -1,6 +1,7 @@
 #ifndef COLOR_UTILS_HPP
 #define COLOR_UTILS_HPP
 
+#include <cstddef>
 #include <opencv2/opencv.hpp>
 #include <string>
 #include <vector>
@@ -14,4 +15,25 @@ std::string strip(const cv::Vec3b &rgbColor);
 float calculateSaturation(const cv::Vec3f &labColor);
 float colorDistance(const cv::Vec3f &a, const cv::Vec3f &b);
 
+// Converts `count` Lab colors to 8-bit RGB with a single cvtColor call into a
+// reused per-thread buffer. Same values as labToBgr(), channel-swapped.
+void labToRgbBatch(const cv::Vec3f *lab, cv::Vec3b *rgb, size_t count);
+
+// HSL and HSV of `count` RGB colors in one branch-free pass. Same values as
+// rgbToHsl() and rgbToHsv().
+void rgbToHslHsvBatch(const cv::Vec3b *rgb, cv::Vec3f *hsl, cv::Vec3f *hsv,
+                      size_t count);
+
+// Allocation-free formatters. They write into `out`, which must hold at least
+// kColorStringCapacity bytes, and return one past the last character written.
+constexpr size_t kColorStringCapacity = 64;
+
+// "#RRGGBB", or "RRGGBB" without the hash.
+char *formatHexTo(char *out, const cv::Vec3b &rgbColor, bool withHash = true);
+
+// "<name>(x, y<unit>, z<unit><tail>", e.g. "hsl(12, 100%, 60%)" or, with tail
+// ", 1.0)", "rgba(255, 87, 51, 1.0)".
+char *formatColorFunctionTo(char *out, const char *name, const int values[3],
+                            const char *unit = "", const char *tail = ")");
+
 #endif
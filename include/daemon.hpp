@@ -0,0 +1,32 @@
+#ifndef DAEMON_HPP
+#define DAEMON_HPP
+
+#include "hooks.hpp"
+#include "palette_cache.hpp"
+#include "pipeline.hpp"
+#include "theme_generator.hpp"
+#include <string>
+
+// $XDG_RUNTIME_DIR/huegen.sock, or /tmp/huegen-<uid>.sock without it.
+std::string daemonSocketPath();
+
+// Serves requests on a Unix domain socket until SIGINT/SIGTERM or a
+// "shutdown" request, keeping compiled templates, the worker pool and the
+// palette cache resident. The socket is created 0600 and connections from
+// other users are refused. `hooks` are dispatched for the themes each
+// request changed and run in the background. One request per connection,
+// one line each way:
+//
+//   extract <image_path>   ->  {"ok":true,"cached":false,"ms":12.3,...}
+//   ping                   ->  {"ok":true}
+//   shutdown               ->  {"ok":true}
+int runDaemon(const std::string &socketPath, const ExtractOptions &opts,
+              PaletteCache *cache, const ThemePaths &paths,
+              HookDispatcher *hooks = nullptr);
+
+// Sends `request` to a running daemon and stores its reply line. Returns
+// false if no daemon is listening or it does not reply in time.
+bool sendDaemonRequest(const std::string &socketPath,
+                       const std::string &request, std::string &response);
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef FILE_UTILS_HPP
+#define FILE_UTILS_HPP
+
+#include <string>
+
+enum class WriteResult { Written, Unchanged, Failed };
+
+// Replaces `path` with `content` atomically (temp file in the same directory
+// + rename), so readers never see a partial file. Skips the write when the
+// existing file already has the same bytes, and keeps the existing
+// file's permissions.
+WriteResult writeFileAtomic(const std::string &path,
+                            const std::string &content);
+
+bool readFile(const std::string &path, std::string &content);
+
+#endif
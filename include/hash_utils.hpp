@@ -0,0 +1,19 @@
+#ifndef HASH_UTILS_HPP
+#define HASH_UTILS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Fast non-cryptographic 64-bit hash, used for content addressing.
+uint64_t hashBytes(const void *data, size_t size, uint64_t seed = 0);
+
+// Cheap identity of a file's current contents: its canonical path, size and
+// mtime (ns) plus the first and last 64 KiB, so keying a large image costs a
+// stat and two small reads instead of reading it whole. Returns false if
+// the file cannot be read.
+bool fingerprintFile(const std::string &path, uint64_t &hash);
+
+std::string hashToHex(uint64_t hash);
+
+#endif
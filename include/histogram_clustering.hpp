@@ -0,0 +1,24 @@
+#ifndef HISTOGRAM_CLUSTERING_HPP
+#define HISTOGRAM_CLUSTERING_HPP
+
+#include "minibatch_kmeans.hpp"
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+// Occupied bins of a BGR histogram quantized to `bits` per channel. Each bin
+// carries the Lab color of its mean pixel and the number of pixels in it.
+struct ColorBins {
+  LabSoA colors;
+  std::vector<float> weights;
+};
+
+ColorBins buildColorBins(const cv::Mat &bgr, int bits = 5);
+
+// Clusters the weighted bins instead of the pixels and returns the heaviest
+// bin of each cluster, so the cost follows color diversity rather than
+// resolution. Takes a full-resolution 8-bit BGR image.
+std::vector<cv::Vec3f> extractHistogramColors(const cv::Mat &bgr, int k = 32,
+                                              int bits = 5,
+                                              uint32_t seed = 0x9e3779b9u);
+
+#endif
@@ -1,10 +1,79 @@
 #ifndef HOOKS_HPP
 #define HOOKS_HPP
 
+#include "template_engine.hpp"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
-void reloadWaybar();
-void reloadHyprland();
-void notifyUser(const std::string &message);
+// One line of hooks.conf, "<theme glob>: <command>", e.g.
+//
+//   waybar.css: pkill -SIGUSR2 waybar
+//   hypr*: hyprctl reload
+//
+// The glob is matched against output theme names. The command is split like
+// a shell word list (quotes, backslashes, a leading ~) but runs without a
+// shell; use sh -c '...' for pipes and redirections.
+struct Hook {
+  std::string pattern;
+  std::vector<std::string> argv;
+};
+
+// ~/.config/huegen/hooks.conf
+std::string defaultHooksPath();
+
+// Splits `command` into words. Returns false on an unterminated quote.
+bool splitCommand(const std::string &command, std::vector<std::string> &argv);
+
+// Reads `path`. Blank lines and # comments are skipped, and malformed lines
+// are reported on stderr. Returns false if the file cannot be read.
+bool loadHooks(const std::string &path, std::vector<Hook> &hooks);
+
+// Runs hooks for changed themes on a pool of `maxConcurrent` worker
+// threads, so template writes and daemon replies never wait for a reload.
+// The limit holds for the whole process, however many dispatches overlap:
+// workers posix_spawn one hook at a time, reap it with waitpid and log its
+// exit status and latency. A hook still queued when a later dispatch matches
+// it again runs once, for the union of the changed themes. The queue lock
+// is only held to push, merge or pop a job, never while a hook is spawned or
+// waited for, so dispatch() does not block on hooks. Not thread-safe:
+// dispatch from one thread.
+class HookDispatcher {
+public:
+  explicit HookDispatcher(std::vector<Hook> hooks, unsigned maxConcurrent = 4);
+  ~HookDispatcher();
+
+  HookDispatcher(const HookDispatcher &) = delete;
+  HookDispatcher &operator=(const HookDispatcher &) = delete;
+
+  // Queues every hook whose pattern matches at least one changed template,
+  // once however many match; $HUEGEN_THEMES lists those templates. Returns
+  // without waiting.
+  void dispatch(const std::vector<TemplateResult> &templates);
+
+  // Blocks until every queued hook has exited.
+  void wait();
+
+private:
+  struct Job {
+    const Hook *hook;
+    std::vector<std::string> themes;
+  };
+
+  void work();
+
+  std::vector<Hook> hooks_;
+  unsigned maxConcurrent_;
+  std::mutex mutex_;
+  std::condition_variable queued_; // job queued or stopping
+  std::condition_variable idle_;   // a job finished
+  std::deque<Job> queue_;
+  size_t running_ = 0;
+  bool stopping_ = false;
+  std::vector<std::thread> workers_;
+};
 
 #endif
@@ -1,9 +1,47 @@
 #ifndef KMEANS_WRAPPER_HPP
 #define KMEANS_WRAPPER_HPP
 
+#include <cstdint>
 #include <opencv2/opencv.hpp>
+#include <string>
 #include <vector>
 
-std::vector<cv::Vec3f> extractClusterColors(const cv::Mat &lab, int k = 32);
+// OpenCV: cv::kmeans, 3 attempts with k-means++ seeding.
+// MiniBatch: native mini-batch k-means (see minibatch_kmeans.hpp).
+// Seeded: histogram-seeded Lloyd's k-means that stops on convergence.
+enum class ClusterEngine { OpenCV, MiniBatch, Seeded };
+
+bool parseClusterEngine(const std::string &name, ClusterEngine &engine);
+const char *clusterEngineName(ClusterEngine engine);
+
+// Seed of every engine's RNG unless --seed overrides it. cv::kmeans draws
+// from theRNG(), which is reset to the seed before each call so repeated
+// extractions in one process (daemon, watch) match a fresh run.
+const uint32_t defaultClusterSeed = 0x9e3779b9u;
+
+// Details of a clustering run for reporting. `iterations` is 0 for the
+// OpenCV engine, which does not expose it.
+struct ClusterStats {
+  int iterations = 0;
+};
+
+std::vector<cv::Vec3f>
+extractClusterColors(const cv::Mat &lab, int k = 32,
+                     ClusterEngine engine = ClusterEngine::OpenCV,
+                     uint32_t seed = defaultClusterSeed,
+                     ClusterStats *stats = nullptr);
+
+// Like extractClusterColors, but when `centers` holds k entries k-means
+// starts from them (a single attempt, no k-means++ seeding). `centers` is
+// replaced by the converged centers so consecutive video frames can chain.
+std::vector<cv::Vec3f>
+extractClusterColorsWarm(const cv::Mat &lab, int k, ClusterEngine engine,
+                         std::vector<cv::Vec3f> &centers,
+                         uint32_t seed = defaultClusterSeed);
+
+// Most frequent quantized Lab color (L to 1, a/b to 0.5) of each cluster,
+// computed in a single pass over `labels`. Empty clusters are skipped.
+std::vector<cv::Vec3f> clusterModes(const cv::Mat &lab, const cv::Mat &labels,
+                                    int k);
 
 #endif
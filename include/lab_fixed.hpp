@@ -0,0 +1,65 @@
+#ifndef LAB_FIXED_HPP
+#define LAB_FIXED_HPP
+
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+// Fixed-point Lab: every channel in 1/labFixedScale units as int16, so L is
+// 0..6400 and a/b stay within about +-8192. A pixel takes 6 bytes instead of
+// the 12 of float Lab (24 counting the float BGR copy cvtColor needs), and
+// squared distances fit in int32.
+const int labFixedScale = 64;
+
+// Channel-separated fixed-point Lab samples.
+struct LabFixedSoA {
+  std::vector<int16_t> l, a, b;
+
+  size_t size() const { return l.size(); }
+};
+
+// Converts 8-bit BGR straight to fixed-point Lab (sRGB, D65, as cvtColor
+// does for float input) with a gamma LUT, an integer RGB->XYZ matrix and a
+// cube-root LUT. No float image is materialized.
+LabFixedSoA bgrToLabFixed(const cv::Mat &bgr);
+
+inline cv::Vec3f labFixedToFloat(const cv::Vec3s &lab) {
+  const float scale = 1.0f / labFixedScale;
+  return cv::Vec3f(lab[0] * scale, lab[1] * scale, lab[2] * scale);
+}
+
+inline int32_t labFixedDistanceSquared(const cv::Vec3s &x,
+                                       const cv::Vec3s &y) {
+  int32_t dl = x[0] - y[0], da = x[1] - y[1], db = x[2] - y[2];
+  return dl * dl + da * da + db * db;
+}
+
+// Index of the nearest center for every point, in integer arithmetic.
+void assignNearestFixed(const LabFixedSoA &points,
+                        const std::vector<cv::Vec3s> &centers, int *labels);
+
+struct FixedKMeansParams {
+  int maxIterations = 20;
+  // Points k-means++ seeding draws from.
+  size_t seedSample = 4096;
+  uint32_t seed = 0x9e3779b9u;
+};
+
+struct FixedKMeansResult {
+  std::vector<cv::Vec3s> centers;
+  std::vector<int> labels;
+  int iterations = 0;
+};
+
+// Lloyd's k-means over fixed-point points with exact integer center sums,
+// seeded with k-means++ on a sample. Stops once no center moves.
+FixedKMeansResult
+fixedKMeans(const LabFixedSoA &points, int k,
+            const FixedKMeansParams &params = FixedKMeansParams());
+
+// Most frequent quantized color of each cluster, like clusterModes().
+std::vector<cv::Vec3f>
+clusterFixedColors(const LabFixedSoA &points, int k,
+                   const FixedKMeansParams &params = FixedKMeansParams());
+
+#endif
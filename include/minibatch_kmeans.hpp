@@ -0,0 +1,89 @@
+#ifndef MINIBATCH_KMEANS_HPP
+#define MINIBATCH_KMEANS_HPP
+
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+// Lab samples stored channel-by-channel so distance kernels can load eight
+// (AVX2) or four (SSE) points per register.
+struct LabSoA {
+  std::vector<float> l, a, b;
+
+  size_t size() const { return l.size(); }
+  void reserve(size_t n);
+  void push(const cv::Vec3f &c);
+
+  // Copies a continuous CV_32FC3 Lab image.
+  static LabSoA fromMat(const cv::Mat &lab);
+};
+
+struct MiniBatchParams {
+  int batchSize = 2048;
+  int maxIterations = 100;
+  // Stop once no center moves by more than this (in Lab units) per batch.
+  float tolerance = 0.05f;
+  uint32_t seed = 0x9e3779b9u;
+};
+
+struct SeededKMeansParams {
+  int maxIterations = 30;
+  // Stop once no center moves by more than this (in Lab units) per pass.
+  // Palette colors are quantized to 0.5 units, so finer gains nothing.
+  float tolerance = 0.1f;
+  // Edge of the Lab histogram cells the seeding runs on.
+  float cellSize = 4.0f;
+  uint32_t seed = 0x9e3779b9u;
+};
+
+struct WeightedKMeansParams {
+  int maxIterations = 50;
+  // Stop once no center moves by more than this (in Lab units) per pass.
+  float tolerance = 0.01f;
+  uint32_t seed = 0x9e3779b9u;
+};
+
+struct KMeansResult {
+  std::vector<cv::Vec3f> centers;
+  std::vector<int> labels;
+  int iterations = 0;
+};
+
+// Index of the nearest center for every point, written to `labels`.
+void assignNearest(const LabSoA &points, const std::vector<cv::Vec3f> &centers,
+                   int *labels);
+
+// Sculley-style mini-batch k-means with k-means++ seeding on a sample.
+// Deterministic for a given seed; labels cover every input point.
+KMeansResult miniBatchKMeans(const LabSoA &points, int k,
+                             const MiniBatchParams &params = MiniBatchParams());
+
+// Warm-started variant: refines `initialCenters` (e.g. the previous video
+// frame's) instead of seeding, so similar inputs converge in a few batches.
+KMeansResult miniBatchKMeans(const LabSoA &points,
+                             std::vector<cv::Vec3f> initialCenters,
+                             const MiniBatchParams &params = MiniBatchParams());
+
+// Lloyd's k-means where point i counts `weights[i]` times, for clustering
+// histogram bins instead of pixels. Seeded with weighted k-means++.
+KMeansResult
+weightedKMeans(const LabSoA &points, const std::vector<float> &weights, int k,
+               const WeightedKMeansParams &params = WeightedKMeansParams());
+
+// Reproducible Lloyd's k-means over every point. Centers are seeded by
+// weighted k-means over a coarse Lab histogram of the points (cells sorted by
+// key, RNG driven by params.seed), which costs O(cells) rather than
+// O(points) and starts close to convergence. Passes stop as soon as no label
+// changes or no center moves more than the tolerance; result.iterations
+// counts them. Identical points and seed give bit-identical results.
+KMeansResult seededKMeans(const LabSoA &points, int k,
+                          const SeededKMeansParams &params =
+                              SeededKMeansParams());
+
+// Warm-started variant: the Lloyd passes start from `initialCenters`.
+KMeansResult seededKMeans(const LabSoA &points,
+                          std::vector<cv::Vec3f> initialCenters,
+                          const SeededKMeansParams &params =
+                              SeededKMeansParams());
+
+#endif
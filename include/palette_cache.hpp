@@ -0,0 +1,58 @@
+#ifndef PALETTE_CACHE_HPP
+#define PALETTE_CACHE_HPP
+
+#include "pipeline.hpp"
+#include <atomic>
+#include <mutex>
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+// On-disk palette store addressed by a fingerprint of the image file (see
+// fingerprintFile) plus the extraction parameters. Once the cache holds more
+// than `maxEntries` palettes, the least recently used are evicted down to
+// 7/8 of that.
+class PaletteCache {
+public:
+  explicit PaletteCache(const std::string &directory = defaultDirectory(),
+                        size_t maxEntries = 512);
+
+  // $XDG_CACHE_HOME/huegen/palettes, falling back to ~/.cache.
+  static std::string defaultDirectory();
+
+  // Returns an empty key if the image cannot be read.
+  std::string keyFor(const std::string &imagePath,
+                     const ExtractOptions &opts) const;
+
+  bool lookup(const std::string &key, std::vector<cv::Vec3f> &palette);
+  void store(const std::string &key, const std::vector<cv::Vec3f> &palette);
+
+  size_t hits() const { return hits_; }
+  size_t misses() const { return misses_; }
+
+  // Adds the hits and misses since the previous call to the totals kept in
+  // the cache directory and returns the updated totals. Long-lived processes
+  // call it after every request.
+  std::pair<size_t, size_t> persistStats();
+
+private:
+  // Counts a stored entry and trims the directory once it holds more than
+  // maxEntries_. The directory is only scanned on the first store and when
+  // the count goes over the limit, not on every store.
+  void evict(bool added);
+
+  std::string directory_;
+  size_t maxEntries_;
+  std::atomic<size_t> hits_{0};
+  std::atomic<size_t> misses_{0};
+  size_t persistedHits_ = 0;
+  size_t persistedMisses_ = 0;
+  // Entries in the directory as of the last scan plus those stored since;
+  // other processes' stores are picked up at the next scan.
+  size_t entryCount_ = 0;
+  bool entriesCounted_ = false;
+  std::mutex evictMutex_;
+  std::mutex statsMutex_;
+};
+
+#endif
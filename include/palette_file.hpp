@@ -0,0 +1,77 @@
+#ifndef PALETTE_FILE_HPP
+#define PALETTE_FILE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// colors.bin: a fixed-layout palette written next to colors.json that
+// consumers mmap and read in place instead of parsing JSON. The file is
+// updated in place (never replaced), so a mapping stays valid and sees every
+// update. Fields use the host's native byte order.
+
+const uint32_t paletteFileMagic = 0x4C415048; // "HPAL"
+const uint16_t paletteFileVersion = 1;
+const int paletteFileEntries = 16;
+
+struct PaletteFileEntry {
+  uint8_t rgb[4]; // sRGB, alpha always 255
+  float lab[3];
+  float hsl[3]; // degrees, percent, percent
+  float hsv[3]; // degrees, percent, percent
+};
+
+// Seqlock protocol: `generation` is odd while a writer is updating the
+// entries and grows by 2 with every palette change. Readers copy the entries
+// between two equal, even loads of it.
+struct PaletteFileLayout {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t count; // valid entries, at most paletteFileEntries
+  std::atomic<uint64_t> generation;
+  PaletteFileEntry entries[paletteFileEntries];
+};
+
+static_assert(sizeof(PaletteFileEntry) == 40, "PaletteFileEntry layout");
+static_assert(sizeof(PaletteFileLayout) == 16 + 40 * paletteFileEntries,
+              "PaletteFileLayout layout");
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "generation must be lock-free to be shared between processes");
+
+struct PaletteSnapshot {
+  uint64_t generation = 0;
+  uint16_t count = 0;
+  PaletteFileEntry entries[paletteFileEntries];
+};
+
+// Stores `count` entries at `path`, creating the file if needed. Concurrent
+// writers are serialized with flock(). The generation is only bumped when
+// the entries actually change. Returns false on I/O errors.
+bool writePaletteFile(const std::string &path, const PaletteFileEntry *entries,
+                      uint16_t count);
+
+// Read-only mapping of a palette file.
+class PaletteFileReader {
+public:
+  PaletteFileReader() = default;
+  PaletteFileReader(const PaletteFileReader &) = delete;
+  PaletteFileReader &operator=(const PaletteFileReader &) = delete;
+  ~PaletteFileReader();
+
+  // Maps `path`. Returns false if it is missing, too short, or has another
+  // magic or version.
+  bool open(const std::string &path);
+  bool isOpen() const { return layout_ != nullptr; }
+
+  // Current generation: a single load from the mapping, cheap to poll.
+  uint64_t generation() const;
+
+  // Copies a consistent snapshot, retrying while a write is in progress.
+  // Returns false if the file stays mid-update for about 100 ms.
+  bool read(PaletteSnapshot &snapshot) const;
+
+private:
+  const PaletteFileLayout *layout_ = nullptr;
+};
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef PALETTE_VARIANTS_HPP
+#define PALETTE_VARIANTS_HPP
+
+#include "color_distance.hpp"
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+// A palette derived from the shared cluster candidates: the `colors` most
+// distinct candidates with lightness in (minLightness, maxLightness]. Its
+// themes are written to themes/<name>/.
+struct PaletteVariant {
+  std::string name;
+  float minLightness = 30.0f;
+  float maxLightness = 100.0f;
+  int colors = 16;
+};
+
+// light: L <= 70, for light backgrounds. contrast: L > 62, at least 7:1
+// (WCAG AAA) against black. colors8 / colors32: the default L > 30 filter
+// at 8 and 32 colors. The default palette itself (L > 30, 16 colors) is
+// the main theme, so no variant repeats it.
+const std::vector<PaletteVariant> &defaultVariants();
+
+// Looks `name` up in defaultVariants().
+bool findVariant(const std::string &name, PaletteVariant &variant);
+
+struct VariantPalette {
+  std::string name;
+  std::vector<cv::Vec3f> colors;
+};
+
+// Picks `variant` from `candidates` using their precomputed `distances` and
+// sorts it by saturation. When fewer candidates pass the lightness filter
+// than the variant has colors, the candidates closest to the range fill in,
+// so every colorN a template uses still resolves.
+std::vector<cv::Vec3f> selectVariant(const std::vector<cv::Vec3f> &candidates,
+                                     const DistanceMatrix &distances,
+                                     const PaletteVariant &variant);
+
+#endif
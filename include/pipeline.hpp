@@ -0,0 +1,95 @@
+#ifndef PIPELINE_HPP
+#define PIPELINE_HPP
+
+#include "color_distance.hpp"
+#include "kmeans_wrapper.hpp"
+#include "palette_variants.hpp"
+#include "region_palette.hpp"
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+// Pixels: downsample to pixelBudget (aspect preserved) and cluster every pixel.
+// Histogram: cluster a weighted color histogram of the full-resolution image.
+// Tiled: assign every full-resolution pixel, tile-parallel (high quality).
+enum class ExtractMode { Pixels, Histogram, Tiled };
+
+bool parseExtractMode(const std::string &name, ExtractMode &mode);
+const char *extractModeName(ExtractMode mode);
+
+struct ExtractOptions {
+  long pixelBudget = 200 * 200;
+  int clusters = 32;
+  float minLightness = 30.0f;
+  int colors = 16;
+  ClusterEngine engine = ClusterEngine::OpenCV;
+  // Seed of the clustering RNG; the same image, options and seed give the
+  // same palette on every run.
+  uint32_t seed = defaultClusterSeed;
+  ExtractMode mode = ExtractMode::Pixels;
+  int histogramBits = 5;
+  // Pixels mode only: convert and cluster in 16-bit fixed-point Lab instead
+  // of float (the engine setting is then ignored).
+  bool fixedPoint = false;
+  // Color difference used to pick the most distinct colors.
+  DistanceMetric metric = DistanceMetric::CIE76;
+  // Screen regions that get their own palette next to the whole-image one
+  // (see extractRegionPalettes). Empty: whole image only.
+  std::vector<Region> regions;
+  // Extra palettes derived from the same candidates (see
+  // extractVariantPalettes). Empty: the main palette only.
+  std::vector<PaletteVariant> variants;
+};
+
+// Stable description of every parameter that influences the palette, used to
+// key cached results.
+std::string optionsSignature(const ExtractOptions &opts);
+
+// Runs downsample -> Lab -> k-means (or the histogram path) -> distinct
+// selection on a decoded BGR image and returns the palette sorted by
+// saturation.
+std::vector<cv::Vec3f> extractPalette(const cv::Mat &bgr,
+                                      const ExtractOptions &opts);
+
+// Pixels-mode extraction for consecutive video frames: k-means is
+// warm-started from `centers` (the previous frame's cluster centers, empty
+// for the first frame), which is updated for the next call. Histogram mode
+// is not used here since downsampled frames are cheap to cluster directly.
+std::vector<cv::Vec3f> extractFramePalette(const cv::Mat &bgr,
+                                           const ExtractOptions &opts,
+                                           std::vector<cv::Vec3f> &centers);
+
+// Decodes `path` and extracts its palette. Returns false if the image could
+// not be loaded.
+bool extractPaletteFromFile(const std::string &path, const ExtractOptions &opts,
+                            std::vector<cv::Vec3f> &palette);
+
+// Whole-image pixels-mode palette plus one palette per opts.regions entry,
+// from a single clustering pass. Every pixel is labelled with its nearest
+// cluster color once; each region's cluster counts then come from summed-area
+// tables in O(clusters), instead of clustering every crop. Region palettes are
+// padded from the whole-image palette to the same length.
+std::vector<cv::Vec3f>
+extractRegionPalettes(const cv::Mat &bgr, const ExtractOptions &opts,
+                      std::vector<RegionPalette> &regions);
+
+bool extractRegionPalettesFromFile(const std::string &path,
+                                   const ExtractOptions &opts,
+                                   std::vector<cv::Vec3f> &palette,
+                                   std::vector<RegionPalette> &regions);
+
+// Main palette plus one palette per opts.variants entry from a single
+// clustering pass, in any mode. The candidates are clustered once, with at
+// least as many clusters as the largest variant has colors, and their
+// distance matrix is built once; each variant is then only a lightness filter
+// and a selection over it (see selectVariant).
+std::vector<cv::Vec3f>
+extractVariantPalettes(const cv::Mat &bgr, const ExtractOptions &opts,
+                       std::vector<VariantPalette> &variants);
+
+bool extractVariantPalettesFromFile(const std::string &path,
+                                    const ExtractOptions &opts,
+                                    std::vector<cv::Vec3f> &palette,
+                                    std::vector<VariantPalette> &variants);
+
+#endif
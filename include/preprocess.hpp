@@ -0,0 +1,23 @@
+#ifndef PREPROCESS_HPP
+#define PREPROCESS_HPP
+
+#include <opencv2/opencv.hpp>
+#include <string>
+
+// Reads the pixel dimensions from a PNG or JPEG header without decoding.
+bool probeImageSize(const std::string &path, cv::Size &size);
+
+// Largest JPEG decode-time reduction (1, 2, 4 or 8) that still leaves at
+// least `pixelBudget` pixels.
+int reducedDecodeFactor(const cv::Size &size, long pixelBudget);
+
+// Aspect-preserving INTER_AREA downscale to at most `pixelBudget` pixels.
+// Images already within budget are returned unchanged.
+cv::Mat downsampleToBudget(const cv::Mat &bgr, long pixelBudget);
+
+// Decodes `path` as BGR, letting the JPEG decoder skip work with
+// IMREAD_REDUCED_COLOR_* when the budget allows it, then downsamples to the
+// budget. A budget <= 0 keeps the full resolution.
+cv::Mat loadImage(const std::string &path, long pixelBudget);
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <cstdint>
+#include <ostream>
+
+// Per-stage wall time and heap allocation counts for --profile. Stages are
+// opened with a scoped profiler::Stage and aggregated by name across calls
+// and threads. Allocation counts are process-wide, so stages running
+// concurrently (batch mode) see each other's allocations. Only C++
+// operator new is counted: cv::Mat buffers (images, Lab and label maps) come
+// from cv::fastMalloc and do not show up.
+namespace profiler {
+
+struct AllocStats {
+  uint64_t count = 0;
+  uint64_t bytes = 0;
+};
+
+void setEnabled(bool enabled);
+bool enabled();
+
+// Allocations made through operator new since startup.
+AllocStats allocations();
+
+class Stage {
+public:
+  explicit Stage(const char *name);
+  ~Stage();
+
+  Stage(const Stage &) = delete;
+  Stage &operator=(const Stage &) = delete;
+
+private:
+  const char *name_;
+  int64_t startNs_;
+  AllocStats startAllocs_;
+};
+
+// Adds one sample of `value` to the counter `name`, e.g. the iterations a
+// k-means run took. Reported after the stages with its sample count, mean
+// and maximum.
+void count(const char *name, int64_t value);
+
+// Table of every stage and counter recorded so far, in first-seen order.
+void report(std::ostream &out);
+void reset();
+
+} // namespace profiler
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef REGION_PALETTE_HPP
+#define REGION_PALETTE_HPP
+
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+// Part of the screen in fractions (0..1) of the image size, e.g. the strip a
+// bar is drawn over. Its palette is exposed to templates as {name.colorN.*}.
+struct Region {
+  std::string name;
+  float x = 0.0f;
+  float y = 0.0f;
+  float width = 1.0f;
+  float height = 1.0f;
+};
+
+// top / bottom: 5% strips (bars), left / right: 10% edges (docks, panels),
+// center: the middle 50% in each direction (notifications, launchers).
+const std::vector<Region> &defaultRegions();
+
+// Characters allowed in region names, which double as template scopes.
+inline bool isRegionNameChar(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_' ||
+         c == '-';
+}
+
+// Parses "name=x,y,w,h" (fractions). Names are [a-z0-9_-] and may not start
+// with "color", which would be ambiguous with {colorN.property}.
+bool parseRegion(const std::string &spec, Region &region);
+
+struct RegionPalette {
+  std::string name;
+  std::vector<cv::Vec3f> colors;
+};
+
+// Per-cluster summed-area tables over a label map, built in one pass. The
+// pixel count of every cluster inside any rectangle then takes 4 lookups per
+// cluster, whatever the rectangle's size.
+class RegionStatistics {
+public:
+  RegionStatistics(const int *labels, int rows, int cols, int clusters);
+
+  int clusters() const { return clusters_; }
+
+  // `region` scaled to the label map, clamped, at least one pixel.
+  cv::Rect toPixels(const Region &region) const;
+
+  // Pixels of each cluster inside `rect`; counts.size() == clusters().
+  void clusterCounts(const cv::Rect &rect, std::vector<int> &counts) const;
+
+private:
+  size_t offset(int row, int col) const {
+    return (static_cast<size_t>(row) * (cols_ + 1) + col) * clusters_;
+  }
+
+  int rows_;
+  int cols_;
+  int clusters_;
+  // (rows + 1) x (cols + 1) x clusters, cluster index fastest.
+  std::vector<int32_t> table_;
+};
+
+#endif
@@ -4,9 +4,10 @@
 #include "color_utils.hpp"
 #include <filesystem>
 #include <fstream>
+#include <map>
+#include <memory>
 #include <nlohmann/json.hpp>
 #include <opencv2/opencv.hpp>
-#include <regex>
 #include <vector>
 
 using namespace cv;
@@ -18,8 +19,72 @@ json colorsToJson(const vector<Vec3f> &labColors);
 
 string colorsToJsonString(const vector<Vec3f> &labColors, int indent = 2);
 
+struct TemplateResult {
+  string name; // output file name (template name without .tlp)
+  string outputPath;
+  bool ok = false;
+  bool changed = false;
+};
+
+// Renders every .tlp in inputDir concurrently and writes each output
+// atomically, leaving byte-identical outputs untouched. When `report` is
+// given it receives one entry per template, sorted by name.
 bool processTemplates(const json &colorJson, const string &inputDir,
-                      const string &outputDir);
+                      const string &outputDir,
+                      vector<TemplateResult> *report = nullptr);
 
 string replaceColorPlaceholders(const string &content, const json &colorJson);
+
+// A template split once into literal spans and {colorN.property} (or
+// {region.colorN.property}) slots, so rendering is a single concatenation
+// with no pattern matching.
+struct CompiledTemplate {
+  struct Slot {
+    int color;    // N, or -1 if the key is not a plain color index
+    int property; // index into templateProperties(), or -1
+    string scope; // region name, empty for the whole-image palette
+    string colorKey;
+    string propertyName;
+  };
+  struct Segment {
+    size_t offset; // into source
+    size_t length;
+    int slot; // -1 for literal text
+  };
+
+  string source;
+  vector<Segment> segments;
+  vector<Slot> slots;
+};
+
+// Property names colorsToJson emits, in slot index order.
+const vector<string> &templateProperties();
+
+CompiledTemplate compileTemplate(const string &content);
+
+// Compiled form of the template at `path`, recompiled only when its mtime or
+// size changes. Returns nullptr if the file cannot be read. Thread-safe.
+shared_ptr<const CompiledTemplate> loadCompiledTemplate(const string &path);
+
+// Placeholder values of one palette, resolved once and shared by every
+// template rendered against it. Region palettes under colorJson["regions"]
+// are resolved the same way, one PaletteValues per region.
+struct PaletteValues {
+  explicit PaletteValues(const json &colorJson);
+
+  const json &colorJson;
+  vector<vector<string>> values; // [color][property]
+  vector<vector<bool>> present;
+  map<string, unique_ptr<PaletteValues>> regions;
+};
+
+string renderTemplate(const CompiledTemplate &compiled,
+                      const PaletteValues &palette);
+
+// Renders the single template at `templatePath` into outputDir/<name>,
+// leaving a byte-identical output untouched. processTemplates() runs this
+// for every .tlp in the directory.
+TemplateResult processTemplate(const string &templatePath,
+                               const string &outputDir,
+                               const PaletteValues &palette);
 #endif
@@ -0,0 +1,59 @@
+#ifndef THEME_GENERATOR_HPP
+#define THEME_GENERATOR_HPP
+
+#include "palette_cache.hpp"
+#include "pipeline.hpp"
+#include "template_engine.hpp"
+#include <string>
+#include <vector>
+
+struct ThemePaths {
+  std::string templateDir;
+  std::string outputDir;
+};
+
+// ~/.config/huegen/templates/ and ~/.config/huegen/themes/
+ThemePaths defaultThemePaths();
+
+struct ThemeRun {
+  bool ok = false;
+  bool cached = false;
+  std::vector<TemplateResult> templates;
+  double seconds = 0.0;
+
+  size_t changedCount() const;
+};
+
+// Palette for `imagePath`, served from `cache` when possible. Returns false
+// if the image cannot be loaded. When opts.regions is set and `regions` is
+// given, region palettes are extracted along with it and the cache is not
+// used; likewise for opts.variants and `variants`.
+bool obtainPalette(const std::string &imagePath, const ExtractOptions &opts,
+                   PaletteCache *cache, std::vector<cv::Vec3f> &palette,
+                   bool &cached, std::vector<RegionPalette> *regions = nullptr,
+                   std::vector<VariantPalette> *variants = nullptr);
+
+// colors.json content: colorsToJson(palette), plus a "regions" object with
+// one colorsToJson entry per region palette.
+json themeColorsJson(const std::vector<cv::Vec3f> &palette,
+                     const std::vector<RegionPalette> &regions);
+
+// Where a variant's themes go: the same templates, outputDir/<name>/.
+ThemePaths variantThemePaths(const ThemePaths &paths, const std::string &name);
+
+// Renders every template and writes colors.json for an extracted palette,
+// then the same for each variant into its own subdirectory. Variant results
+// are named "<variant>/<template>". colors.bin holds at most
+// paletteFileEntries (16) colors, the most saturated ones; larger palettes
+// such as colors32 are complete only in colors.json and the templates.
+ThemeRun writeThemes(const std::vector<cv::Vec3f> &palette,
+                     const ThemePaths &paths,
+                     const std::vector<RegionPalette> &regions = {},
+                     const std::vector<VariantPalette> &variants = {});
+
+// Full image -> written themes path shared by the CLI and the daemon.
+ThemeRun generateThemes(const std::string &imagePath,
+                        const ExtractOptions &opts, PaletteCache *cache,
+                        const ThemePaths &paths);
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads that stay alive between calls, so repeated
+// work (daemon requests, batch runs, template rendering) does not pay for
+// thread creation each time.
+class ThreadPool {
+public:
+  explicit ThreadPool(unsigned threads = 0);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  // Process-wide pool sized to the number of cores.
+  static ThreadPool &shared();
+
+  unsigned size() const { return static_cast<unsigned>(workers_.size()) + 1; }
+
+  // Calls fn(i) for every i in [0, count) using at most `maxWorkers` threads
+  // (0 = all), including the calling thread, and returns when all are done.
+  // Nested calls from inside a task run inline. If fn throws, remaining
+  // indices are skipped and the first exception is rethrown here after
+  // every thread has stopped using fn.
+  void parallelFor(size_t count, const std::function<void(size_t)> &fn,
+                   unsigned maxWorkers = 0);
+
+private:
+  struct Job;
+
+  void workerLoop();
+  static void runJob(Job &job);
+
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::mutex submitMutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  Job *job_ = nullptr;
+  size_t generation_ = 0;
+  bool stopping_ = false;
+};
+
+// Turns OpenCV's own threading off while alive: work already spread over
+// the pool would only oversubscribe the cores if every cvtColor fanned out
+// again. Scopes may nest and overlap across threads; the first one saves
+// OpenCV's thread count and the last one to end restores it. Inactive
+// scopes do nothing.
+class SerialOpenCvScope {
+public:
+  explicit SerialOpenCvScope(bool active = true);
+  ~SerialOpenCvScope();
+
+  SerialOpenCvScope(const SerialOpenCvScope &) = delete;
+  SerialOpenCvScope &operator=(const SerialOpenCvScope &) = delete;
+
+private:
+  bool active_;
+};
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef TILED_PIPELINE_HPP
+#define TILED_PIPELINE_HPP
+
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+struct TileParams {
+  // Tile edge in pixels. A 64x64 tile's float BGR, Lab, channel-separated
+  // copy and labels take about 160 KB, so it stays in L2 cache.
+  int tileSize = 64;
+  // Pixels of the downsampled copy the cluster centers are trained on.
+  long seedBudget = 256 * 256;
+  // Worker slots on the shared pool; 0 uses every core.
+  unsigned threads = 0;
+  uint32_t seed = 0x9e3779b9u;
+};
+
+// Full-resolution pixel clustering for large images. Centers are trained
+// with mini-batch k-means on a downsampled copy. One pass over the 8-bit
+// BGR image then runs on the shared thread pool, where each worker pulls
+// tiles from a shared counter and, per tile, converts to Lab, assigns every
+// pixel to its nearest center and counts it into the worker's own
+// (cluster, color) histogram. The per-worker histograms are merged once at
+// the end, so the pass takes no locks. Returns the most frequent quantized
+// color of each cluster, like extractClusterColors().
+std::vector<cv::Vec3f>
+extractTiledColors(const cv::Mat &bgr, int k = 32,
+                   const TileParams &params = TileParams());
+
+#endif
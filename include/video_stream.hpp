@@ -0,0 +1,41 @@
+#ifndef VIDEO_STREAM_HPP
+#define VIDEO_STREAM_HPP
+
+#include "pipeline.hpp"
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+struct StreamOptions {
+  // Frames analysed per second of clip time; 0 analyses every frame.
+  double sampleFps = 2.0;
+  // Weight of each new frame palette in the smoothed palette (0..1].
+  float smoothing = 0.25f;
+  // When set, one JSON line per sampled frame is appended here.
+  std::string timelinePath;
+};
+
+struct StreamReport {
+  bool ok = false;
+  long framesDecoded = 0;
+  long framesSampled = 0;
+  double seconds = 0.0;
+};
+
+// Decodes a video or animated image frame by frame (cv::VideoCapture, with
+// imreadmulti as the fallback for multi-page images), extracts the palette
+// of every sampled frame with k-means warm-started from the previous frame
+// and folds it into `smoothed` with an exponential moving average. Only one
+// decoded frame is held at a time, so memory does not grow with clip length.
+StreamReport extractStreamPalette(const std::string &path,
+                                  const ExtractOptions &opts,
+                                  const StreamOptions &stream,
+                                  std::vector<cv::Vec3f> &smoothed);
+
+// Moves each color of `smoothed` towards its closest counterpart in `frame`
+// by `weight`, pairing colors greedily by Lab distance. Unpaired frame colors
+// are appended; the result is re-sorted by saturation.
+void blendPalettes(std::vector<cv::Vec3f> &smoothed,
+                   const std::vector<cv::Vec3f> &frame, float weight);
+
+#endif
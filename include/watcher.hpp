@@ -0,0 +1,22 @@
+#ifndef WATCHER_HPP
+#define WATCHER_HPP
+
+#include "hooks.hpp"
+#include "palette_cache.hpp"
+#include "pipeline.hpp"
+#include "theme_generator.hpp"
+#include <string>
+
+// Renders themes for `imagePath`, then watches it and the template directory
+// with inotify until SIGINT/SIGTERM. Replacing or rewriting the image (or the
+// file a symlinked image points to) re-extracts the palette and renders
+// every template; editing a .tlp re-renders only that template against the
+// last palette, and deleting or renaming one away deletes its output. An
+// inotify queue overflow counts as a change to everything. Events are
+// coalesced until `debounceMs` pass without new ones. `hooks` fire for
+// every theme a re-render changed.
+int runWatch(const std::string &imagePath, const ExtractOptions &opts,
+             PaletteCache *cache, const ThemePaths &paths,
+             int debounceMs = 200, HookDispatcher *hooks = nullptr);
+
+#endif
@@ -0,0 +1,180 @@
+#include "batch.hpp"
+#include "color_utils.hpp"
+#include "file_utils.hpp"
+#include "template_engine.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <set>
+
+using namespace std;
+using namespace cv;
+namespace fs = std::filesystem;
+
+static bool isImageFile(const fs::path &path) {
+  static const vector<string> extensions = {".png", ".jpg", ".jpeg", ".webp",
+                                            ".bmp", ".tif", ".tiff"};
+  string ext = path.extension().string();
+  transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+  return find(extensions.begin(), extensions.end(), ext) != extensions.end();
+}
+
+vector<string> collectBatchInputs(const string &source) {
+  vector<string> inputs;
+  if (fs::is_directory(source)) {
+    for (const auto &entry : fs::directory_iterator(source)) {
+      if (entry.is_regular_file() && isImageFile(entry.path()))
+        inputs.push_back(entry.path().string());
+    }
+    sort(inputs.begin(), inputs.end());
+    return inputs;
+  }
+
+  ifstream list(source);
+  string line;
+  while (getline(list, line)) {
+    if (!line.empty() && line.back() == '\r')
+      line.pop_back();
+    if (!line.empty() && line[0] != '#')
+      inputs.push_back(line);
+  }
+  return inputs;
+}
+
+// Palette for `path`, from `cache` when it has one.
+static bool paletteFor(const string &path, const ExtractOptions &opts,
+                       PaletteCache *cache, vector<Vec3f> &palette) {
+  string key = cache ? cache->keyFor(path, opts) : "";
+  if (!key.empty() && cache->lookup(key, palette))
+    return true;
+  if (!extractPaletteFromFile(path, opts, palette))
+    return false;
+  if (!key.empty())
+    cache->store(key, palette);
+  return true;
+}
+
+// Runs `extractOne` for every input on up to `jobs` pool workers with
+// OpenCV's own threading disabled, and times the whole pass.
+template <typename F>
+static double forEachInput(size_t count, unsigned &jobs, F &&extractOne) {
+  ThreadPool &pool = ThreadPool::shared();
+  if (jobs == 0)
+    jobs = pool.size();
+  jobs = min<unsigned>(jobs, max<size_t>(count, 1));
+
+  // Parallelism comes from running one image per worker; letting OpenCV
+  // spawn its own threads inside each worker only oversubscribes the cores.
+  SerialOpenCvScope serialOpenCv(jobs > 1);
+
+  auto start = chrono::steady_clock::now();
+  pool.parallelFor(count, extractOne, jobs);
+  auto end = chrono::steady_clock::now();
+  return chrono::duration<double>(end - start).count();
+}
+
+// Output file name per input: the image's file name plus ".json", with a
+// "-2", "-3"... suffix for names already taken by an earlier input (list
+// files may hold a/wall.png and b/wall.png).
+static vector<string> outputNames(const vector<string> &inputs) {
+  vector<string> names;
+  set<string> taken;
+  for (const string &path : inputs) {
+    string base = fs::path(path).filename().string();
+    string name = base + ".json";
+    for (int n = 2; !taken.insert(name).second; ++n)
+      name = base + "-" + to_string(n) + ".json";
+    if (name != base + ".json")
+      cerr << "Output name " << base << ".json is taken; writing " << path
+           << " to " << name << "\n";
+    names.push_back(move(name));
+  }
+  return names;
+}
+
+BatchReport runBatch(const vector<string> &inputs, const string &outputDir,
+                     const ExtractOptions &opts, unsigned jobs,
+                     PaletteCache *cache) {
+  BatchReport report;
+  fs::create_directories(outputDir);
+  vector<string> names = outputNames(inputs);
+
+  atomic<size_t> processed{0};
+  atomic<size_t> failed{0};
+  mutex outputMutex;
+
+  auto extractOne = [&](size_t i) {
+    const string &path = inputs[i];
+    vector<Vec3f> palette;
+    if (!paletteFor(path, opts, cache, palette)) {
+      lock_guard<mutex> lock(outputMutex);
+      cerr << "Failed to load image: " << path << "\n";
+      failed++;
+      return;
+    }
+
+    // Atomic, so a reader never sees a half-written palette and an
+    // interrupted rerun leaves the previous file intact.
+    string outputPath = outputDir + "/" + names[i];
+    if (writeFileAtomic(outputPath, colorsToJson(palette).dump(4)) ==
+        WriteResult::Failed) {
+      lock_guard<mutex> lock(outputMutex);
+      cerr << "Error: Could not write file " << outputPath << "\n";
+      failed++;
+      return;
+    }
+    processed++;
+  };
+
+  report.seconds = forEachInput(inputs.size(), jobs, extractOne);
+  report.processed = processed;
+  report.failed = failed;
+  return report;
+}
+
+static json contactSheetRecord(const string &path,
+                               const vector<Vec3f> &palette) {
+  vector<Vec3b> rgb(palette.size());
+  labToRgbBatch(palette.data(), rgb.data(), palette.size());
+
+  json colors = json::array();
+  char buffer[kColorStringCapacity];
+  for (const Vec3b &color : rgb)
+    colors.push_back(string(buffer, formatHexTo(buffer, color)));
+  return {{"path", path}, {"colors", colors}};
+}
+
+BatchReport runBatchStream(const vector<string> &inputs, ostream &out,
+                           const ExtractOptions &opts, unsigned jobs,
+                           PaletteCache *cache) {
+  BatchReport report;
+  size_t processed = 0;
+  size_t failed = 0;
+  mutex outputMutex;
+
+  auto extractOne = [&](size_t i) {
+    const string &path = inputs[i];
+    vector<Vec3f> palette;
+    bool ok = paletteFor(path, opts, cache, palette);
+    // Serialize outside the lock; only the write is serialized.
+    string line = (ok ? contactSheetRecord(path, palette)
+                      : json{{"path", path}, {"error", "load failed"}})
+                      .dump();
+
+    lock_guard<mutex> lock(outputMutex);
+    out << line << '\n';
+    out.flush();
+    if (ok)
+      processed++;
+    else
+      failed++;
+  };
+
+  report.seconds = forEachInput(inputs.size(), jobs, extractOne);
+  report.processed = processed;
+  report.failed = failed;
+  return report;
+}
@@ -0,0 +1,241 @@
+#include "color_distance.hpp"
+#include <cmath>
+
+using namespace std;
+using namespace cv;
+
+bool parseDistanceMetric(const string &name, DistanceMetric &metric) {
+  if (name == "cie76") {
+    metric = DistanceMetric::CIE76;
+  } else if (name == "ciede2000") {
+    metric = DistanceMetric::CIEDE2000;
+  } else if (name == "cam16ucs") {
+    metric = DistanceMetric::CAM16UCS;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char *distanceMetricName(DistanceMetric metric) {
+  switch (metric) {
+  case DistanceMetric::CIEDE2000:
+    return "ciede2000";
+  case DistanceMetric::CAM16UCS:
+    return "cam16ucs";
+  case DistanceMetric::CIE76:
+  default:
+    return "cie76";
+  }
+}
+
+namespace {
+
+const double pi = 3.14159265358979323846;
+
+inline double degrees(double radians) { return radians * 180.0 / pi; }
+inline double radians(double degrees) { return degrees * pi / 180.0; }
+
+// Hue angle in [0, 360).
+inline double hueAngle(double b, double a) {
+  if (a == 0 && b == 0)
+    return 0;
+  double h = degrees(atan2(b, a));
+  return h < 0 ? h + 360.0 : h;
+}
+
+// Viewing-condition constants of the CAM16 model, derived once.
+struct Cam16Conditions {
+  double dRgb[3];
+  double fl, flRoot, n, z, nbb, aw;
+  double c = 0.69, nc = 1.0;
+
+  Cam16Conditions() {
+    // Same D65 white as OpenCV's Lab conversion, Y scaled to 100.
+    const double white[3] = {95.0456, 100.0, 108.8754};
+    const double la = 64.0 / pi / 5.0;
+    const double yb = 20.0;
+    const double f = 1.0;
+
+    double rgbW[3];
+    toCone(white, rgbW);
+    double d = f * (1.0 - (1.0 / 3.6) * exp((-la - 42.0) / 92.0));
+    d = min(max(d, 0.0), 1.0);
+    for (int i = 0; i < 3; ++i)
+      dRgb[i] = d * white[1] / rgbW[i] + 1.0 - d;
+
+    double k = 1.0 / (5.0 * la + 1.0);
+    double k4 = k * k * k * k;
+    fl = 0.2 * k4 * (5.0 * la) + 0.1 * pow(1.0 - k4, 2) * cbrt(5.0 * la);
+    flRoot = pow(fl, 0.25);
+    n = yb / white[1];
+    z = 1.48 + sqrt(n);
+    nbb = 0.725 * pow(n, -0.2);
+
+    double adapted[3];
+    for (int i = 0; i < 3; ++i)
+      adapted[i] = adapt(dRgb[i] * rgbW[i]);
+    aw = (2.0 * adapted[0] + adapted[1] + 0.05 * adapted[2] - 0.305) * nbb;
+  }
+
+  static void toCone(const double xyz[3], double rgb[3]) {
+    static const double m16[3][3] = {{0.401288, 0.650173, -0.051461},
+                                     {-0.250268, 1.204414, 0.045854},
+                                     {-0.002079, 0.048952, 0.953127}};
+    for (int i = 0; i < 3; ++i)
+      rgb[i] = m16[i][0] * xyz[0] + m16[i][1] * xyz[1] + m16[i][2] * xyz[2];
+  }
+
+  double adapt(double component) const {
+    double x = pow(fl * fabs(component) / 100.0, 0.42);
+    return copysign(400.0 * x / (x + 27.13), component) + 0.1;
+  }
+};
+
+const Cam16Conditions &cam16() {
+  static const Cam16Conditions conditions;
+  return conditions;
+}
+
+inline double labInverse(double t) {
+  double t3 = t * t * t;
+  return t3 > 0.008856 ? t3 : (t - 16.0 / 116.0) / 7.787;
+}
+
+} // namespace
+
+float ciede2000(const Vec3f &lab1, const Vec3f &lab2) {
+  double l1 = lab1[0], a1 = lab1[1], b1 = lab1[2];
+  double l2 = lab2[0], a2 = lab2[1], b2 = lab2[2];
+
+  double cMean = (hypot(a1, b1) + hypot(a2, b2)) / 2.0;
+  double cMean7 = pow(cMean, 7);
+  double g = 0.5 * (1.0 - sqrt(cMean7 / (cMean7 + pow(25.0, 7))));
+  double a1p = (1.0 + g) * a1, a2p = (1.0 + g) * a2;
+  double c1p = hypot(a1p, b1), c2p = hypot(a2p, b2);
+  double h1p = hueAngle(b1, a1p), h2p = hueAngle(b2, a2p);
+
+  double dLp = l2 - l1;
+  double dCp = c2p - c1p;
+  double dhp = 0;
+  if (c1p * c2p != 0) {
+    dhp = h2p - h1p;
+    if (dhp > 180)
+      dhp -= 360;
+    else if (dhp < -180)
+      dhp += 360;
+  }
+  double dHp = 2.0 * sqrt(c1p * c2p) * sin(radians(dhp / 2.0));
+
+  double lMean = (l1 + l2) / 2.0;
+  double cMeanP = (c1p + c2p) / 2.0;
+  double hMeanP = h1p + h2p;
+  if (c1p * c2p != 0) {
+    if (fabs(h1p - h2p) <= 180)
+      hMeanP /= 2.0;
+    else if (h1p + h2p < 360)
+      hMeanP = (h1p + h2p + 360) / 2.0;
+    else
+      hMeanP = (h1p + h2p - 360) / 2.0;
+  }
+
+  double t = 1.0 - 0.17 * cos(radians(hMeanP - 30)) +
+             0.24 * cos(radians(2 * hMeanP)) +
+             0.32 * cos(radians(3 * hMeanP + 6)) -
+             0.20 * cos(radians(4 * hMeanP - 63));
+  double dTheta = 30.0 * exp(-pow((hMeanP - 275.0) / 25.0, 2));
+  double cMeanP7 = pow(cMeanP, 7);
+  double rC = 2.0 * sqrt(cMeanP7 / (cMeanP7 + pow(25.0, 7)));
+  double lOffset = (lMean - 50) * (lMean - 50);
+  double sL = 1.0 + 0.015 * lOffset / sqrt(20.0 + lOffset);
+  double sC = 1.0 + 0.045 * cMeanP;
+  double sH = 1.0 + 0.015 * cMeanP * t;
+  double rT = -sin(radians(2.0 * dTheta)) * rC;
+
+  double tl = dLp / sL, tc = dCp / sC, th = dHp / sH;
+  return static_cast<float>(sqrt(tl * tl + tc * tc + th * th + rT * tc * th));
+}
+
+Vec3f labToCam16Ucs(const Vec3f &lab) {
+  const Cam16Conditions &vc = cam16();
+
+  double fy = (lab[0] + 16.0) / 116.0;
+  double xyz[3] = {95.0456 * labInverse(fy + lab[1] / 500.0),
+                   100.0 * labInverse(fy),
+                   108.8754 * labInverse(fy - lab[2] / 200.0)};
+  double rgb[3];
+  Cam16Conditions::toCone(xyz, rgb);
+  double adapted[3];
+  for (int i = 0; i < 3; ++i)
+    adapted[i] = vc.adapt(vc.dRgb[i] * rgb[i]);
+
+  double a = adapted[0] - 12.0 * adapted[1] / 11.0 + adapted[2] / 11.0;
+  double b = (adapted[0] + adapted[1] - 2.0 * adapted[2]) / 9.0;
+  double h = hueAngle(b, a);
+  double eccentricity = 0.25 * (cos(radians(h) + 2.0) + 3.8);
+  double achromatic =
+      (2.0 * adapted[0] + adapted[1] + 0.05 * adapted[2] - 0.305) * vc.nbb;
+  double j = 100.0 * pow(max(achromatic, 0.0) / vc.aw, vc.c * vc.z);
+  double t = (50000.0 / 13.0 * vc.nc * vc.nbb * eccentricity * hypot(a, b)) /
+             (adapted[0] + adapted[1] + 21.0 / 20.0 * adapted[2]);
+  double chroma =
+      pow(t, 0.9) * sqrt(j / 100.0) * pow(1.64 - pow(0.29, vc.n), 0.73);
+  double colorfulness = chroma * vc.flRoot;
+
+  double jp = 1.7 * j / (1.0 + 0.007 * j);
+  double mp = log(1.0 + 0.0228 * colorfulness) / 0.0228;
+  return Vec3f(static_cast<float>(jp), static_cast<float>(mp * cos(radians(h))),
+               static_cast<float>(mp * sin(radians(h))));
+}
+
+// Euclidean distances from one point to channel-separated points.
+static void euclideanRow(const Vec3f &reference, const vector<float> &l,
+                         const vector<float> &a, const vector<float> &b,
+                         float *out) {
+  for (size_t j = 0; j < l.size(); ++j) {
+    float dl = l[j] - reference[0];
+    float da = a[j] - reference[1];
+    float db = b[j] - reference[2];
+    out[j] = std::sqrt(dl * dl + da * da + db * db);
+  }
+}
+
+static void splitChannels(const vector<Vec3f> &colors, vector<float> &l,
+                          vector<float> &a, vector<float> &b) {
+  l.resize(colors.size());
+  a.resize(colors.size());
+  b.resize(colors.size());
+  for (size_t j = 0; j < colors.size(); ++j) {
+    l[j] = colors[j][0];
+    a[j] = colors[j][1];
+    b[j] = colors[j][2];
+  }
+}
+
+DistanceMatrix::DistanceMatrix(const vector<Vec3f> &colors,
+                               DistanceMetric metric)
+    : size_(colors.size()), metric_(metric),
+      distances_(colors.size() * colors.size(), 0.0f) {
+  if (metric == DistanceMetric::CIEDE2000) {
+    // Symmetric but expensive: evaluate the upper triangle only.
+    for (size_t i = 0; i < size_; ++i) {
+      for (size_t j = i + 1; j < size_; ++j) {
+        float d = ciede2000(colors[i], colors[j]);
+        distances_[i * size_ + j] = d;
+        distances_[j * size_ + i] = d;
+      }
+    }
+    return;
+  }
+
+  // Euclidean metrics: transform once, then one contiguous row at a time.
+  vector<Vec3f> points = colors;
+  if (metric == DistanceMetric::CAM16UCS) {
+    for (Vec3f &p : points)
+      p = labToCam16Ucs(p);
+  }
+  vector<float> l, a, b;
+  splitChannels(points, l, a, b);
+  for (size_t i = 0; i < size_; ++i)
+    euclideanRow(points[i], l, a, b, distances_.data() + i * size_);
+}
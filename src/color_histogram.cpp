@@ -0,0 +1,76 @@
+#include "color_histogram.hpp"
+
+using namespace std;
+using namespace cv;
+
+ColorHistogram::ColorHistogram(size_t expected) {
+  size_t capacity = 1024;
+  while (capacity < expected * 2)
+    capacity <<= 1;
+  keys_.assign(capacity, emptySlot);
+  counts_.assign(capacity, 0);
+}
+
+void ColorHistogram::add(uint64_t key, int count) {
+  size_t mask = keys_.size() - 1;
+  size_t slot = slotFor(key, mask);
+  while (keys_[slot] != key) {
+    if (keys_[slot] == emptySlot) {
+      if ((size_ + 1) * 2 > keys_.size()) {
+        grow();
+        add(key, count);
+        return;
+      }
+      keys_[slot] = key;
+      size_++;
+      break;
+    }
+    slot = (slot + 1) & mask;
+  }
+  counts_[slot] += count;
+}
+
+void ColorHistogram::merge(const ColorHistogram &other) {
+  other.forEach([this](uint64_t key, int count) { add(key, count); });
+}
+
+void ColorHistogram::grow() {
+  vector<uint64_t> oldKeys = move(keys_);
+  vector<int> oldCounts = move(counts_);
+  keys_.assign(oldKeys.size() * 2, emptySlot);
+  counts_.assign(oldKeys.size() * 2, 0);
+  size_t mask = keys_.size() - 1;
+  for (size_t i = 0; i < oldKeys.size(); ++i) {
+    if (oldKeys[i] == emptySlot)
+      continue;
+    size_t slot = slotFor(oldKeys[i], mask);
+    while (keys_[slot] != emptySlot)
+      slot = (slot + 1) & mask;
+    keys_[slot] = oldKeys[i];
+    counts_[slot] = oldCounts[i];
+  }
+}
+
+vector<Vec3f> histogramModes(const ColorHistogram &histogram, int k) {
+  // Ties resolve to the smallest (L, a, b), matching an ordered scan.
+  vector<int> bestCount(k, 0);
+  vector<uint64_t> bestCode(k, UINT64_MAX);
+  histogram.forEach([&](uint64_t key, int count) {
+    int cluster = static_cast<int>(key >> 40);
+    uint64_t code = key & ((1ULL << 40) - 1);
+    if (cluster < 0 || cluster >= k)
+      return;
+    if (count > bestCount[cluster] ||
+        (count == bestCount[cluster] && code < bestCode[cluster])) {
+      bestCount[cluster] = count;
+      bestCode[cluster] = code;
+    }
+  });
+
+  vector<Vec3f> allColors;
+  for (int cluster = 0; cluster < k; ++cluster) {
+    if (bestCount[cluster] > 0)
+      allColors.push_back(dequantizeLab(bestCode[cluster]));
+  }
+  return allColors;
+}
@@ -1,45 +1,135 @@
 #include "color_selector.hpp"
 #include "color_utils.hpp"
 #include <cfloat>
+#include <numeric>
 
 using namespace std;
 using namespace cv;
 
+// Incremental farthest-point sampling. Each candidate keeps its squared
+// distance to the nearest selected color, refreshed only against the color
+// added last, so a round costs O(n) instead of O(n * selected). Picks are
+// identical to comparing sqrt distances against every selected color: sqrt
+// is monotonic, ties still go to the earliest candidate.
 vector<Vec3f> selectMostDistinctColors(const vector<Vec3f> &colors, int n) {
   if (colors.empty())
     return {};
 
+  size_t count = colors.size();
+  vector<float> l(count), a(count), b(count);
+  for (size_t i = 0; i < count; ++i) {
+    l[i] = colors[i][0];
+    a[i] = colors[i][1];
+    b[i] = colors[i][2];
+  }
+
+  // Negative marks a candidate that has already been selected.
+  vector<float> minDistSq(count, FLT_MAX);
   vector<Vec3f> selected;
-  vector<Vec3f> remaining = colors;
+  size_t remaining = count;
+
+  auto select = [&](size_t index) {
+    selected.push_back(colors[index]);
+    minDistSq[index] = -1.0f;
+    remaining--;
+
+    const float sl = l[index], sa = a[index], sb = b[index];
+    float *minDist = minDistSq.data();
+    for (size_t i = 0; i < count; ++i) {
+      float dl = l[i] - sl;
+      float da = a[i] - sa;
+      float db = b[i] - sb;
+      minDist[i] = min(minDist[i], dl * dl + da * da + db * db);
+    }
+  };
 
   auto maxSatIt = max_element(
-      remaining.begin(), remaining.end(), [](const Vec3f &a, const Vec3f &b) {
-        return calculateSaturation(a) < calculateSaturation(b);
+      colors.begin(), colors.end(), [](const Vec3f &x, const Vec3f &y) {
+        return calculateSaturation(x) < calculateSaturation(y);
       });
+  select(maxSatIt - colors.begin());
 
-  selected.push_back(*maxSatIt);
-  remaining.erase(maxSatIt);
-
-  while (selected.size() < n && !remaining.empty()) {
-    int bestIndex = 0;
+  while (selected.size() < static_cast<size_t>(n) && remaining > 0) {
+    size_t bestIndex = count;
     float maxMinDistance = 0.0f;
 
-    for (int i = 0; i < remaining.size(); ++i) {
-      float minDist = FLT_MAX;
-
-      for (const auto &s : selected) {
-        float dist = colorDistance(remaining[i], s);
-        minDist = min(minDist, dist);
-      }
-
+    for (size_t i = 0; i < count; ++i) {
+      if (minDistSq[i] < 0.0f)
+        continue;
+      if (bestIndex == count)
+        bestIndex = i;
+      float minDist = std::sqrt(minDistSq[i]);
       if (minDist > maxMinDistance) {
         maxMinDistance = minDist;
         bestIndex = i;
       }
     }
 
-    selected.push_back(remaining[bestIndex]);
-    remaining.erase(remaining.begin() + bestIndex);
+    select(bestIndex);
+  }
+
+  return selected;
+}
+
+// Matrix-backed variant: the seed and tie rules match the function above, but
+// refreshing the nearest-selected distances reads one precomputed row.
+vector<Vec3f> selectMostDistinctColors(const vector<Vec3f> &colors, int n,
+                                       const DistanceMatrix &distances) {
+  vector<size_t> all(colors.size());
+  iota(all.begin(), all.end(), size_t(0));
+  vector<Vec3f> selected;
+  for (size_t index : selectMostDistinctIndices(colors, all, n, distances))
+    selected.push_back(colors[index]);
+  return selected;
+}
+
+vector<size_t> selectMostDistinctIndices(const vector<Vec3f> &colors,
+                                         const vector<size_t> &subset, int n,
+                                         const DistanceMatrix &distances) {
+  if (subset.empty() || distances.size() != colors.size())
+    return {};
+
+  size_t count = subset.size();
+  vector<float> minDist(count, FLT_MAX);
+  vector<size_t> selected;
+  size_t remaining = count;
+
+  auto select = [&](size_t index) {
+    selected.push_back(subset[index]);
+    minDist[index] = -1.0f;
+    remaining--;
+
+    const float *row = distances.row(subset[index]);
+    for (size_t i = 0; i < count; ++i) {
+      if (minDist[i] >= 0.0f)
+        minDist[i] = min(minDist[i], row[subset[i]]);
+    }
+  };
+
+  size_t maxSat = 0;
+  for (size_t i = 1; i < count; ++i) {
+    if (calculateSaturation(colors[subset[i]]) >
+        calculateSaturation(colors[subset[maxSat]]))
+      maxSat = i;
+  }
+  select(maxSat);
+
+  while (selected.size() < static_cast<size_t>(n) && remaining > 0) {
+    size_t bestIndex = count;
+    float maxMinDistance = 0.0f;
+
+    for (size_t i = 0; i < count; ++i) {
+      if (minDist[i] < 0.0f)
+        continue;
+      if (bestIndex == count)
+        bestIndex = i;
+      if (minDist[i] > maxMinDistance) {
+        maxMinDistance = minDist[i];
+        bestIndex = i;
+      }
+    }
+
+    select(bestIndex);
   }
 
   return selected;
@@ -1,4 +1,5 @@
 #include "color_utils.hpp"
+#include <charconv>
 #include <cmath>
 #include <opencv2/opencv.hpp>
 #include <string>
@@ -10,82 +11,107 @@ Vec3b bgrToRgb(const Vec3b &bgrColor) {
 }
 
 Vec3f rgbToHsl(const Vec3b &rgbColor) {
-  float r = rgbColor[0] / 255.0f;
-  float g = rgbColor[1] / 255.0f;
-  float b = rgbColor[2] / 255.0f;
-
-  float max_val = max({r, g, b});
-  float min_val = min({r, g, b});
-  float delta = max_val - min_val;
-
-  float h = 0, s = 0, l = (max_val + min_val) / 2.0f;
-
-  if (delta != 0) {
-    s = (l > 0.5f) ? delta / (2.0f - max_val - min_val)
-                   : delta / (max_val + min_val);
-
-    if (max_val == r) {
-      h = ((g - b) / delta) + (g < b ? 6 : 0);
-    } else if (max_val == g) {
-      h = (b - r) / delta + 2;
-    } else {
-      h = (r - g) / delta + 4;
-    }
-    h /= 6.0f;
-  }
-
-  return Vec3f(h * 360.0f, s * 100.0f, l * 100.0f);
+  Vec3f hsl, hsv;
+  rgbToHslHsvBatch(&rgbColor, &hsl, &hsv, 1);
+  return hsl;
 }
 
 Vec3f rgbToHsv(const Vec3b &rgbColor) {
-  float r = rgbColor[0] / 255.0f;
-  float g = rgbColor[1] / 255.0f;
-  float b = rgbColor[2] / 255.0f;
+  Vec3f hsl, hsv;
+  rgbToHslHsvBatch(&rgbColor, &hsl, &hsv, 1);
+  return hsv;
+}
 
-  float max_val = max({r, g, b});
-  float min_val = min({r, g, b});
-  float delta = max_val - min_val;
+void rgbToHslHsvBatch(const Vec3b *rgb, Vec3f *hsl, Vec3f *hsv,
+                      size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    float r = rgb[i][0] / 255.0f;
+    float g = rgb[i][1] / 255.0f;
+    float b = rgb[i][2] / 255.0f;
+
+    float max_val = max(r, max(g, b));
+    float min_val = min(r, min(g, b));
+    float delta = max_val - min_val;
+    float l = (max_val + min_val) / 2.0f;
+
+    // Every branch is computed and the result selected, so the loop has no
+    // data-dependent jumps; the divisors are only guarded against zero.
+    bool chromatic = delta != 0;
+    float safeDelta = chromatic ? delta : 1.0f;
+    float hueR = ((g - b) / safeDelta) + (g < b ? 6 : 0);
+    float hueG = (b - r) / safeDelta + 2;
+    float hueB = (r - g) / safeDelta + 4;
+    float h = max_val == r ? hueR : (max_val == g ? hueG : hueB);
+    h = chromatic ? h / 6.0f : 0.0f;
+
+    float hslDivisor =
+        (l > 0.5f) ? 2.0f - max_val - min_val : max_val + min_val;
+    float hslS = chromatic ? delta / hslDivisor : 0.0f;
+    // Black has max_val == 0 and therefore delta == 0 as well.
+    float hsvS = delta / (max_val != 0 ? max_val : 1.0f);
+
+    hsl[i] = Vec3f(h * 360.0f, hslS * 100.0f, l * 100.0f);
+    hsv[i] = Vec3f(h * 360.0f, hsvS * 100.0f, max_val * 100.0f);
+  }
+}
 
-  float h = 0, s = 0, v = max_val;
+static const char kHexDigits[] = "0123456789ABCDEF";
 
-  if (max_val != 0) {
-    s = delta / max_val;
+char *formatHexTo(char *out, const Vec3b &rgbColor, bool withHash) {
+  if (withHash)
+    *out++ = '#';
+  for (int c = 0; c < 3; ++c) {
+    *out++ = kHexDigits[rgbColor[c] >> 4];
+    *out++ = kHexDigits[rgbColor[c] & 0xF];
   }
+  return out;
+}
 
-  if (delta != 0) {
-    if (max_val == r) {
-      h = ((g - b) / delta) + (g < b ? 6 : 0);
-    } else if (max_val == g) {
-      h = (b - r) / delta + 2;
-    } else {
-      h = (r - g) / delta + 4;
-    }
-    h /= 6.0f;
-  }
+static char *appendText(char *out, const char *text) {
+  while (*text)
+    *out++ = *text++;
+  return out;
+}
 
-  return Vec3f(h * 360.0f, s * 100.0f, v * 100.0f);
+char *formatColorFunctionTo(char *out, const char *name, const int values[3],
+                            const char *unit, const char *tail) {
+  out = appendText(out, name);
+  *out++ = '(';
+  for (int c = 0; c < 3; ++c) {
+    if (c > 0)
+      out = appendText(out, ", ");
+    out = to_chars(out, out + 12, values[c]).ptr;
+    if (c > 0)
+      out = appendText(out, unit);
+  }
+  return appendText(out, tail);
 }
 
 string formatHex(const Vec3b &rgbColor) {
-  stringstream ss;
-  ss << "#" << hex << uppercase << setfill('0') << setw(2) << (int)rgbColor[0]
-     << setw(2) << (int)rgbColor[1] << setw(2) << (int)rgbColor[2];
-  return ss.str();
+  char buffer[kColorStringCapacity];
+  return string(buffer, formatHexTo(buffer, rgbColor));
 }
 
 string strip(const Vec3b &rgbColor) {
-  stringstream ss;
-  ss << hex << uppercase << setfill('0') << setw(2) << (int)rgbColor[0]
-     << setw(2) << (int)rgbColor[1] << setw(2) << (int)rgbColor[2];
-  return ss.str();
+  char buffer[kColorStringCapacity];
+  return string(buffer, formatHexTo(buffer, rgbColor, false));
+}
+
+void labToRgbBatch(const Vec3f *lab, Vec3b *rgb, size_t count) {
+  if (count == 0)
+    return;
+  // cvtColor only reallocates this when the batch size changes.
+  thread_local Mat rgbFloat;
+  Mat labMat(1, static_cast<int>(count), CV_32FC3, const_cast<Vec3f *>(lab));
+  cvtColor(labMat, rgbFloat, COLOR_Lab2RGB);
+  Mat out(1, static_cast<int>(count), CV_8UC3, rgb);
+  rgbFloat.convertTo(out, CV_8UC3, 255.0);
 }
 
 Vec3b labToBgr(Vec3f labColor) {
-  Mat lab(1, 1, CV_32FC3, Scalar(labColor[0], labColor[1], labColor[2]));
-  Mat bgr;
-  cvtColor(lab, bgr, COLOR_Lab2BGR);
-  bgr.convertTo(bgr, CV_8UC3, 255.0);
-  return bgr.at<Vec3b>(0, 0);
+  Vec3b rgb;
+  labToRgbBatch(&labColor, &rgb, 1);
+  return bgrToRgb(rgb);
 }
 
 float calculateSaturation(const Vec3f &labColor) {
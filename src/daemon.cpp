@@ -0,0 +1,214 @@
+#include "daemon.hpp"
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <nlohmann/json.hpp>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+using json = nlohmann::json;
+
+static volatile sig_atomic_t stopRequested = 0;
+
+// Connections are served one at a time, so a client that never finishes its
+// request line (or never reads the reply) must not hold the daemon.
+static const int clientTimeoutSeconds = 2;
+
+// A client waits this long for a reply; an uncached extraction of a large
+// image takes a few seconds, a wedged daemon forever.
+static const int replyTimeoutSeconds = 30;
+
+static void handleStopSignal(int) { stopRequested = 1; }
+
+string daemonSocketPath() {
+  const char *runtimeDir = getenv("XDG_RUNTIME_DIR");
+  if (runtimeDir && *runtimeDir)
+    return string(runtimeDir) + "/huegen.sock";
+  return "/tmp/huegen-" + to_string(getuid()) + ".sock";
+}
+
+static bool makeAddress(const string &path, sockaddr_un &addr) {
+  if (path.size() >= sizeof(addr.sun_path)) {
+    cerr << "Socket path too long: " << path << "\n";
+    return false;
+  }
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+  return true;
+}
+
+static bool writeAll(int fd, const string &data) {
+  size_t sent = 0;
+  while (sent < data.size()) {
+    ssize_t n = write(fd, data.data() + sent, data.size() - sent);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    sent += static_cast<size_t>(n);
+  }
+  return true;
+}
+
+static void setTimeouts(int fd, int seconds) {
+  timeval timeout{seconds, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
+
+// Requests name files to read and themes to overwrite, so only the user the
+// daemon runs as may send them.
+static bool sameUser(int fd) {
+  ucred cred;
+  socklen_t length = sizeof(cred);
+  if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &length) < 0)
+    return false;
+  return cred.uid == geteuid();
+}
+
+static bool readLine(int fd, string &line) {
+  line.clear();
+  char c;
+  while (line.size() < 8192) {
+    ssize_t n = read(fd, &c, 1);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0)
+      return false; // including a receive timeout
+    if (n == 0)
+      return !line.empty();
+    if (c == '\n')
+      return true;
+    line += c;
+  }
+  return false;
+}
+
+static json handleRequest(const string &request, const ExtractOptions &opts,
+                          PaletteCache *cache, const ThemePaths &paths,
+                          HookDispatcher *hooks) {
+  if (request == "ping" || request == "shutdown")
+    return {{"ok", true}};
+
+  const string extract = "extract ";
+  if (request.compare(0, extract.size(), extract) != 0)
+    return {{"ok", false}, {"error", "unknown request"}};
+
+  string imagePath = request.substr(extract.size());
+  ThemeRun run = generateThemes(imagePath, opts, cache, paths);
+  if (hooks)
+    hooks->dispatch(run.templates);
+  if (cache)
+    cache->persistStats();
+
+  json changed = json::array();
+  for (const auto &t : run.templates) {
+    if (t.changed)
+      changed.push_back(t.name);
+  }
+  return {{"ok", run.ok},
+          {"cached", run.cached},
+          {"ms", run.seconds * 1000.0},
+          {"changed", changed},
+          {"templates", run.templates.size()}};
+}
+
+int runDaemon(const string &socketPath, const ExtractOptions &opts,
+              PaletteCache *cache, const ThemePaths &paths,
+              HookDispatcher *hooks) {
+  sockaddr_un addr;
+  if (!makeAddress(socketPath, addr))
+    return 1;
+
+  string reply;
+  if (sendDaemonRequest(socketPath, "ping", reply)) {
+    cerr << "A daemon is already listening on " << socketPath << "\n";
+    return 1;
+  }
+  // Left over from a daemon that did not shut down cleanly.
+  unlink(socketPath.c_str());
+
+  // Create the socket file as 0600 rather than chmod it after bind(), which
+  // would leave a window in which other users can connect.
+  int server = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  mode_t previousMask = umask(0177);
+  bool bound =
+      server >= 0 &&
+      bind(server, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0;
+  umask(previousMask);
+  if (!bound || listen(server, 16) < 0) {
+    cerr << "Could not listen on " << socketPath << ": " << strerror(errno)
+         << "\n";
+    if (server >= 0)
+      close(server);
+    return 1;
+  }
+
+  // No SA_RESTART: a signal must interrupt accept() so the loop can exit.
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = handleStopSignal;
+  sigaction(SIGINT, &action, nullptr);
+  sigaction(SIGTERM, &action, nullptr);
+  signal(SIGPIPE, SIG_IGN);
+
+  cout << "Listening on " << socketPath << endl;
+  while (!stopRequested) {
+    int client = accept4(server, nullptr, nullptr, SOCK_CLOEXEC);
+    if (client < 0) {
+      if (errno == EINTR)
+        continue;
+      cerr << "accept failed: " << strerror(errno) << "\n";
+      break;
+    }
+    if (!sameUser(client)) {
+      cerr << "Rejected a connection from another user\n";
+      close(client);
+      continue;
+    }
+    setTimeouts(client, clientTimeoutSeconds);
+
+    string request;
+    if (readLine(client, request)) {
+      json response = handleRequest(request, opts, cache, paths, hooks);
+      if (response.contains("ms")) {
+        cout << request << ": " << response["ms"].get<double>() << " ms"
+             << (response["cached"].get<bool>() ? " (cached)" : "") << endl;
+      }
+      writeAll(client, response.dump() + "\n");
+      if (request == "shutdown")
+        stopRequested = 1;
+    }
+    close(client);
+  }
+
+  close(server);
+  unlink(socketPath.c_str());
+  return 0;
+}
+
+bool sendDaemonRequest(const string &socketPath, const string &request,
+                       string &response) {
+  sockaddr_un addr;
+  if (!makeAddress(socketPath, addr))
+    return false;
+
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0)
+    return false;
+  setTimeouts(fd, replyTimeoutSeconds);
+  if (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+    close(fd);
+    return false;
+  }
+
+  bool ok = writeAll(fd, request + "\n") && readLine(fd, response);
+  close(fd);
+  return ok;
+}
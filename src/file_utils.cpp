@@ -0,0 +1,65 @@
+#include "file_utils.hpp"
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <unistd.h>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+bool readFile(const string &path, string &content) {
+  ifstream file(path, ios::binary);
+  if (!file.is_open())
+    return false;
+  content.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+  return !file.bad();
+}
+
+static bool sameContent(const string &path, const string &content) {
+  error_code ec;
+  uintmax_t size = fs::file_size(path, ec);
+  if (ec || size != content.size())
+    return false;
+
+  // Byte comparison: cheaper than hashing both, and no collision can skip
+  // a needed write.
+  string existing;
+  if (!readFile(path, existing))
+    return false;
+  return existing.size() == content.size() && existing == content;
+}
+
+WriteResult writeFileAtomic(const string &path, const string &content) {
+  if (sameContent(path, content))
+    return WriteResult::Unchanged;
+
+  static atomic<unsigned> counter{0};
+  fs::path target(path);
+  fs::path tmpPath = target.parent_path() /
+                     ("." + target.filename().string() + ".tmp" +
+                      to_string(getpid()) + "-" + to_string(counter++));
+  {
+    ofstream file(tmpPath, ios::binary);
+    if (!file.is_open())
+      return WriteResult::Failed;
+    file << content;
+    file.close();
+    if (file.fail()) {
+      error_code ec;
+      fs::remove(tmpPath, ec);
+      return WriteResult::Failed;
+    }
+  }
+
+  error_code ec;
+  auto status = fs::status(target, ec);
+  if (!ec && fs::exists(status))
+    fs::permissions(tmpPath, status.permissions(), ec);
+
+  fs::rename(tmpPath, target, ec);
+  if (ec) {
+    fs::remove(tmpPath, ec);
+    return WriteResult::Failed;
+  }
+  return WriteResult::Written;
+}
@@ -0,0 +1,98 @@
+#include "hash_utils.hpp"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sys/stat.h>
+#include <vector>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+static inline uint64_t mix(uint64_t a, uint64_t b) {
+  __uint128_t r = static_cast<__uint128_t>(a) * b;
+  return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64);
+}
+
+static inline uint64_t read64(const unsigned char *p) {
+  uint64_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+uint64_t hashBytes(const void *data, size_t size, uint64_t seed) {
+  const uint64_t k0 = 0xa0761d6478bd642fULL;
+  const uint64_t k1 = 0xe7037ed1a0b428dbULL;
+  const uint64_t k2 = 0x8ebc6af09c88c6e3ULL;
+
+  const unsigned char *p = static_cast<const unsigned char *>(data);
+  uint64_t h = seed ^ k0;
+  size_t remaining = size;
+
+  // Two independent lanes keep the multiplier pipeline busy on large inputs.
+  if (remaining >= 32) {
+    uint64_t h1 = h ^ k2;
+    while (remaining >= 32) {
+      h = mix(read64(p) ^ k1, read64(p + 8) ^ h);
+      h1 = mix(read64(p + 16) ^ k2, read64(p + 24) ^ h1);
+      p += 32;
+      remaining -= 32;
+    }
+    h = mix(h ^ k1, h1 ^ k0);
+  }
+
+  while (remaining >= 8) {
+    h = mix(read64(p) ^ k1, h ^ k2);
+    p += 8;
+    remaining -= 8;
+  }
+
+  if (remaining > 0) {
+    uint64_t tail = 0;
+    memcpy(&tail, p, remaining);
+    h = mix(tail ^ k1, h ^ k2);
+  }
+
+  return mix(h ^ size, k0 ^ k2);
+}
+
+// Bytes read from each end of the file by fingerprintFile.
+static const size_t fingerprintSample = 64 * 1024;
+
+bool fingerprintFile(const string &path, uint64_t &hash) {
+  error_code ec;
+  string canonical = fs::canonical(path, ec).string();
+  struct stat info;
+  if (ec || stat(canonical.c_str(), &info) != 0)
+    return false;
+  ifstream file(canonical, ios::binary);
+  if (!file.is_open())
+    return false;
+
+  size_t size = static_cast<size_t>(info.st_size);
+  size_t head = min(size, fingerprintSample);
+  size_t tail = min(size - head, fingerprintSample);
+  vector<char> buffer(head + tail);
+  if (!file.read(buffer.data(), head))
+    return false;
+  if (tail > 0 && !(file.seekg(size - tail) &&
+                    file.read(buffer.data() + head, tail)))
+    return false;
+
+  long long mtime = info.st_mtim.tv_sec * 1000000000LL + info.st_mtim.tv_nsec;
+  string identity = canonical + '\0' + to_string(size) + ':' +
+                    to_string(mtime);
+  hash = hashBytes(identity.data(), identity.size(),
+                   hashBytes(buffer.data(), buffer.size()));
+  return true;
+}
+
+string hashToHex(uint64_t hash) {
+  static const char digits[] = "0123456789abcdef";
+  string out(16, '0');
+  for (int i = 15; i >= 0; --i) {
+    out[i] = digits[hash & 0xf];
+    hash >>= 4;
+  }
+  return out;
+}
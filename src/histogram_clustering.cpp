@@ -0,0 +1,85 @@
+#include "histogram_clustering.hpp"
+#include <cmath>
+#include <cstdint>
+
+using namespace std;
+using namespace cv;
+
+ColorBins buildColorBins(const Mat &bgr, int bits) {
+  bits = max(1, min(bits, 8));
+  int shift = 8 - bits;
+  size_t binCount = size_t(1) << (3 * bits);
+
+  vector<uint32_t> counts(binCount, 0);
+  vector<uint64_t> sums(binCount * 3, 0);
+
+  for (int row = 0; row < bgr.rows; ++row) {
+    const Vec3b *pixel = bgr.ptr<Vec3b>(row);
+    for (int col = 0; col < bgr.cols; ++col) {
+      const Vec3b &p = pixel[col];
+      size_t bin = (size_t(p[0] >> shift) << (2 * bits)) |
+                   (size_t(p[1] >> shift) << bits) | size_t(p[2] >> shift);
+      counts[bin]++;
+      sums[bin * 3] += p[0];
+      sums[bin * 3 + 1] += p[1];
+      sums[bin * 3 + 2] += p[2];
+    }
+  }
+
+  size_t occupied = 0;
+  for (uint32_t c : counts)
+    occupied += c > 0;
+
+  // Convert every bin mean to Lab in one cvtColor call.
+  Mat means(1, static_cast<int>(max<size_t>(occupied, 1)), CV_32FC3);
+  ColorBins bins;
+  bins.weights.reserve(occupied);
+  Vec3f *mean = means.ptr<Vec3f>(0);
+  for (size_t bin = 0, j = 0; bin < binCount; ++bin) {
+    if (counts[bin] == 0)
+      continue;
+    float scale = 1.0f / (255.0f * counts[bin]);
+    mean[j++] = Vec3f(sums[bin * 3] * scale, sums[bin * 3 + 1] * scale,
+                      sums[bin * 3 + 2] * scale);
+    bins.weights.push_back(static_cast<float>(counts[bin]));
+  }
+  if (occupied == 0)
+    return bins;
+
+  Mat lab;
+  cvtColor(means, lab, COLOR_BGR2Lab);
+  bins.colors = LabSoA::fromMat(lab);
+  return bins;
+}
+
+vector<Vec3f> extractHistogramColors(const Mat &bgr, int k, int bits,
+                                     uint32_t seed) {
+  ColorBins bins = buildColorBins(bgr, bits);
+  WeightedKMeansParams params;
+  params.seed = seed;
+  KMeansResult result = weightedKMeans(bins.colors, bins.weights, k, params);
+  if (result.labels.empty())
+    return {};
+
+  vector<float> bestWeight(k, 0.0f);
+  vector<size_t> bestBin(k, 0);
+  for (size_t i = 0; i < result.labels.size(); ++i) {
+    int c = result.labels[i];
+    if (bins.weights[i] > bestWeight[c]) {
+      bestWeight[c] = bins.weights[i];
+      bestBin[c] = i;
+    }
+  }
+
+  // Same quantization as the per-pixel cluster modes.
+  vector<Vec3f> allColors;
+  for (int c = 0; c < k; ++c) {
+    if (bestWeight[c] <= 0)
+      continue;
+    size_t i = bestBin[c];
+    allColors.emplace_back(round(bins.colors.l[i]),
+                           round(bins.colors.a[i] * 2) / 2.0f,
+                           round(bins.colors.b[i] * 2) / 2.0f);
+  }
+  return allColors;
+}
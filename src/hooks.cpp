@@ -1,20 +1,255 @@
 #include "hooks.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <chrono>
 #include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <fstream>
 #include <iostream>
+#include <spawn.h>
+#include <sys/wait.h>
 
-void reloadWaybar() {
-  int status = std::system("pkill -SIGUSR2 waybar");
-  std::cout << (status == 0 ? "Reloaded Waybar" : "Failed to reload Waybar")
-            << std::endl;
+extern char **environ;
+
+using namespace std;
+
+string defaultHooksPath() {
+  const char *home = getenv("HOME");
+  return string(home ? home : ".") + "/.config/huegen/hooks.conf";
+}
+
+bool splitCommand(const string &command, vector<string> &argv) {
+  argv.clear();
+  string word;
+  bool inWord = false;
+  char quote = 0;
+  for (size_t i = 0; i < command.size(); ++i) {
+    char c = command[i];
+    if (quote) {
+      if (c == quote)
+        quote = 0;
+      else if (c == '\\' && quote == '"' && i + 1 < command.size())
+        word += command[++i];
+      else
+        word += c;
+    } else if (c == '\'' || c == '"') {
+      quote = c;
+      inWord = true;
+    } else if (c == '\\' && i + 1 < command.size()) {
+      word += command[++i];
+      inWord = true;
+    } else if (c == ' ' || c == '\t') {
+      if (inWord)
+        argv.push_back(move(word));
+      word.clear();
+      inWord = false;
+    } else if (c == '~' && !inWord &&
+               (i + 1 == command.size() || command[i + 1] == '/' ||
+                command[i + 1] == ' ')) {
+      const char *home = getenv("HOME");
+      word += home ? home : "~";
+      inWord = true;
+    } else {
+      word += c;
+      inWord = true;
+    }
+  }
+  if (quote)
+    return false;
+  if (inWord)
+    argv.push_back(move(word));
+  return true;
+}
+
+static string trim(const string &text) {
+  size_t begin = text.find_first_not_of(" \t\r");
+  if (begin == string::npos)
+    return "";
+  size_t end = text.find_last_not_of(" \t\r");
+  return text.substr(begin, end - begin + 1);
+}
+
+bool loadHooks(const string &path, vector<Hook> &hooks) {
+  ifstream file(path);
+  if (!file.is_open())
+    return false;
+
+  hooks.clear();
+  string line;
+  for (int number = 1; getline(file, line); ++number) {
+    string text = trim(line);
+    if (text.empty() || text[0] == '#')
+      continue;
+
+    size_t colon = text.find(':');
+    Hook hook;
+    if (colon != string::npos)
+      hook.pattern = trim(text.substr(0, colon));
+    if (hook.pattern.empty() ||
+        !splitCommand(trim(text.substr(colon + 1)), hook.argv) ||
+        hook.argv.empty()) {
+      cerr << path << ":" << number
+           << ": expected '<theme glob>: <command>'\n";
+      continue;
+    }
+    hooks.push_back(move(hook));
+  }
+  return true;
+}
+
+struct HookResult {
+  string command;  // argv[0]
+  string themes;   // changed themes that fired it, comma-separated
+  int status = -1; // exit status; -1 if not spawned or killed
+  double ms = 0.0; // spawn to exit
+};
+
+static HookResult runHook(const Hook &hook, const string &themes) {
+  HookResult result;
+  result.command = hook.argv[0];
+  result.themes = themes;
+
+  vector<char *> argv;
+  for (const string &arg : hook.argv)
+    argv.push_back(const_cast<char *>(arg.c_str()));
+  argv.push_back(nullptr);
+
+  const char themesKey[] = "HUEGEN_THEMES=";
+  string themesVar = themesKey + themes;
+  vector<char *> env;
+  for (char **var = environ; *var; ++var) {
+    if (strncmp(*var, themesKey, sizeof(themesKey) - 1) != 0)
+      env.push_back(*var);
+  }
+  env.push_back(&themesVar[0]);
+  env.push_back(nullptr);
+
+  // Hooks must not read the daemon's or the terminal's input.
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_addopen(&actions, 0, "/dev/null", O_RDONLY, 0);
+
+  // The daemon ignores SIGPIPE, which exec would pass on; hooks get the
+  // default disposition and an empty mask, like a command run from a shell.
+  posix_spawnattr_t attr;
+  posix_spawnattr_init(&attr);
+  sigset_t defaults, mask;
+  sigemptyset(&defaults);
+  sigaddset(&defaults, SIGPIPE);
+  sigemptyset(&mask);
+  posix_spawnattr_setsigdefault(&attr, &defaults);
+  posix_spawnattr_setsigmask(&attr, &mask);
+  posix_spawnattr_setflags(&attr,
+                           POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK);
+
+  auto start = chrono::steady_clock::now();
+  pid_t pid;
+  int error =
+      posix_spawnp(&pid, argv[0], &actions, &attr, argv.data(), env.data());
+  posix_spawnattr_destroy(&attr);
+  posix_spawn_file_actions_destroy(&actions);
+  if (error != 0) {
+    cerr << "Hook " + result.command + " (" + themes +
+                ") could not be started: " + strerror(error) + "\n";
+    return result;
+  }
+
+  int status = 0;
+  while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+  }
+  result.ms =
+      chrono::duration<double, milli>(chrono::steady_clock::now() - start)
+          .count();
+  result.status = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+
+  // One write per line, so lines of concurrent hooks do not interleave.
+  cout << "Hook " + result.command + " (" + themes + "): exit " +
+              to_string(result.status) + " in " +
+              to_string(static_cast<long>(result.ms)) + " ms\n"
+       << flush;
+  return result;
+}
+
+HookDispatcher::HookDispatcher(vector<Hook> hooks, unsigned maxConcurrent)
+    : hooks_(move(hooks)), maxConcurrent_(max(1u, maxConcurrent)) {}
+
+HookDispatcher::~HookDispatcher() {
+  wait();
+  {
+    lock_guard<mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  queued_.notify_all();
+  for (thread &worker : workers_)
+    worker.join();
 }
 
-void reloadHyprland() {
-  int status = std::system("hyprctl reload");
-  std::cout << (status == 0 ? "Reloaded Hyprland" : "Failed to reload Hyprland")
-            << std::endl;
+void HookDispatcher::dispatch(const vector<TemplateResult> &templates) {
+  vector<Job> jobs;
+  for (const Hook &hook : hooks_) {
+    Job job{&hook, {}};
+    for (const TemplateResult &t : templates) {
+      if (t.changed && fnmatch(hook.pattern.c_str(), t.name.c_str(), 0) == 0)
+        job.themes.push_back(t.name);
+    }
+    if (!job.themes.empty())
+      jobs.push_back(move(job));
+  }
+  if (jobs.empty())
+    return;
+
+  {
+    lock_guard<mutex> lock(mutex_);
+    for (Job &job : jobs) {
+      // A queued run of the same hook has not started yet and will see
+      // these themes too; widen it instead of reloading twice.
+      auto queued = find_if(queue_.begin(), queue_.end(), [&](const Job &q) {
+        return q.hook == job.hook;
+      });
+      if (queued == queue_.end()) {
+        queue_.push_back(move(job));
+        continue;
+      }
+      for (string &theme : job.themes) {
+        if (find(queued->themes.begin(), queued->themes.end(), theme) ==
+            queued->themes.end())
+          queued->themes.push_back(move(theme));
+      }
+    }
+  }
+  // Workers start with the first dispatch, so runs without hooks that
+  // match never create threads.
+  while (workers_.size() < maxConcurrent_)
+    workers_.emplace_back([this] { work(); });
+  queued_.notify_all();
+}
+
+void HookDispatcher::work() {
+  unique_lock<mutex> lock(mutex_);
+  for (;;) {
+    queued_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+    if (queue_.empty())
+      return;
+    Job job = move(queue_.front());
+    queue_.pop_front();
+    running_++;
+    lock.unlock();
+
+    string themes;
+    for (const string &theme : job.themes)
+      themes += (themes.empty() ? "" : ",") + theme;
+    runHook(*job.hook, themes);
+
+    lock.lock();
+    running_--;
+    idle_.notify_all();
+  }
 }
 
-void notifyUser(const std::string &message) {
-  std::string cmd = "notify-send 'PostInstall' '" + message + "'";
-  std::system(cmd.c_str());
+void HookDispatcher::wait() {
+  unique_lock<mutex> lock(mutex_);
+  idle_.wait(lock, [this] { return queue_.empty() && running_ == 0; });
 }
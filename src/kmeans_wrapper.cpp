@@ -1,57 +1,124 @@
 #include "kmeans_wrapper.hpp"
-#include <map>
+#include "color_histogram.hpp"
+#include "minibatch_kmeans.hpp"
 
 using namespace std;
 using namespace cv;
 
-vector<Vec3f> extractClusterColors(const Mat &lab, int k) {
+vector<Vec3f> clusterModes(const Mat &lab, const Mat &labels, int k) {
+  // Distinct quantized colors are usually far fewer than pixels.
+  ColorHistogram histogram(min<size_t>(lab.total(), 1 << 16));
+  const int *label = labels.ptr<int>();
+
+  for (int row = 0; row < lab.rows; ++row) {
+    const Vec3f *pixel = lab.ptr<Vec3f>(row);
+    for (int col = 0; col < lab.cols; ++col, ++label)
+      histogram.add(clusterColorKey(*label, quantizeLab(pixel[col])));
+  }
+  return histogramModes(histogram, k);
+}
+
+bool parseClusterEngine(const string &name, ClusterEngine &engine) {
+  if (name == "opencv") {
+    engine = ClusterEngine::OpenCV;
+  } else if (name == "minibatch") {
+    engine = ClusterEngine::MiniBatch;
+  } else if (name == "seeded") {
+    engine = ClusterEngine::Seeded;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char *clusterEngineName(ClusterEngine engine) {
+  switch (engine) {
+  case ClusterEngine::MiniBatch:
+    return "minibatch";
+  case ClusterEngine::Seeded:
+    return "seeded";
+  case ClusterEngine::OpenCV:
+  default:
+    return "opencv";
+  }
+}
+
+vector<Vec3f> extractClusterColors(const Mat &lab, int k, ClusterEngine engine,
+                                   uint32_t seed, ClusterStats *stats) {
+  if (engine != ClusterEngine::OpenCV) {
+    KMeansResult result;
+    if (engine == ClusterEngine::Seeded) {
+      SeededKMeansParams params;
+      params.seed = seed;
+      result = seededKMeans(LabSoA::fromMat(lab), k, params);
+    } else {
+      MiniBatchParams params;
+      params.seed = seed;
+      result = miniBatchKMeans(LabSoA::fromMat(lab), k, params);
+    }
+    if (stats)
+      stats->iterations = result.iterations;
+    Mat labels(static_cast<int>(result.labels.size()), 1, CV_32S,
+               result.labels.data());
+    return clusterModes(lab, labels, k);
+  }
+
   Mat samples = lab.reshape(1, lab.rows * lab.cols);
   Mat labels, centers;
 
+  theRNG().state = seed;
   kmeans(samples, k, labels,
          TermCriteria(TermCriteria::EPS + TermCriteria::COUNT, 10, 1.0), 3,
          KMEANS_PP_CENTERS, centers);
 
-  vector<Vec3f> allColors;
-
-  auto vec3fCompare = [](const Vec3f &a, const Vec3f &b) {
-    if (a[0] != b[0])
-      return a[0] < b[0];
-    if (a[1] != b[1])
-      return a[1] < b[1];
-    return a[2] < b[2];
-  };
-
-  for (int cluster = 0; cluster < k; ++cluster) {
-    map<Vec3f, int, decltype(vec3fCompare)> colorCount(vec3fCompare);
-
-    for (int i = 0; i < labels.rows; ++i) {
-      if (labels.at<int>(i, 0) == cluster) {
-        int row = i / lab.cols;
-        int col = i % lab.cols;
-        Vec3f labColor = lab.at<Vec3f>(row, col);
+  return clusterModes(lab, labels, k);
+}
 
-        labColor[0] = round(labColor[0]);
-        labColor[1] = round(labColor[1] * 2) / 2.0f;
-        labColor[2] = round(labColor[2] * 2) / 2.0f;
+vector<Vec3f> extractClusterColorsWarm(const Mat &lab, int k,
+                                       ClusterEngine engine,
+                                       vector<Vec3f> &centers, uint32_t seed) {
+  bool warm = static_cast<int>(centers.size()) == k;
 
-        colorCount[labColor]++;
-      }
+  if (engine != ClusterEngine::OpenCV) {
+    LabSoA points = LabSoA::fromMat(lab);
+    KMeansResult result;
+    if (engine == ClusterEngine::Seeded) {
+      SeededKMeansParams params;
+      params.seed = seed;
+      result = warm ? seededKMeans(points, centers, params)
+                    : seededKMeans(points, k, params);
+    } else {
+      MiniBatchParams params;
+      params.seed = seed;
+      result = warm ? miniBatchKMeans(points, centers, params)
+                    : miniBatchKMeans(points, k, params);
     }
+    centers = result.centers;
+    Mat labels(static_cast<int>(result.labels.size()), 1, CV_32S,
+               result.labels.data());
+    return clusterModes(lab, labels, k);
+  }
 
-    Vec3f mostFrequent;
-    int maxCount = 0;
-    for (const auto &pair : colorCount) {
-      if (pair.second > maxCount) {
-        maxCount = pair.second;
-        mostFrequent = pair.first;
-      }
-    }
+  Mat samples = lab.reshape(1, lab.rows * lab.cols);
+  Mat labels, centerMat;
+  TermCriteria criteria(TermCriteria::EPS + TermCriteria::COUNT, 10, 1.0);
 
-    if (maxCount > 0) {
-      allColors.push_back(mostFrequent);
-    }
+  theRNG().state = seed;
+  if (warm) {
+    // cv::kmeans cannot take initial centers, only initial labels, so
+    // start from the nearest-center assignment.
+    labels.create(samples.rows, 1, CV_32S);
+    assignNearest(LabSoA::fromMat(lab), centers, labels.ptr<int>());
+    kmeans(samples, k, labels, criteria, 1, KMEANS_USE_INITIAL_LABELS,
+           centerMat);
+  } else {
+    kmeans(samples, k, labels, criteria, 3, KMEANS_PP_CENTERS, centerMat);
   }
 
-  return allColors;
+  centers.resize(k);
+  for (int c = 0; c < k; ++c) {
+    const float *row = centerMat.ptr<float>(c);
+    centers[c] = Vec3f(row[0], row[1], row[2]);
+  }
+  return clusterModes(lab, labels, k);
 }
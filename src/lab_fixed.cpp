@@ -0,0 +1,229 @@
+#include "lab_fixed.hpp"
+#include "color_histogram.hpp"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <random>
+
+using namespace std;
+using namespace cv;
+
+namespace {
+
+// Linear sRGB in Q16, the RGB->XYZ matrix (already divided by the D65 white
+// point) in Q15, and f(t) of the Lab definition in Q15 for t in Q16.
+const int linearBits = 16;
+const int matrixBits = 15;
+const int cubeRootBits = 15;
+const int cubeRootSize = 1 << linearBits;
+
+struct LabTables {
+  uint16_t linear[256];
+  int32_t matrix[3][3]; // rows X, Y, Z; columns R, G, B
+  vector<int32_t> cubeRoot;
+
+  LabTables() : cubeRoot(cubeRootSize + 1) {
+    for (int v = 0; v < 256; ++v) {
+      double x = v / 255.0;
+      x = x <= 0.04045 ? x / 12.92 : pow((x + 0.055) / 1.055, 2.4);
+      linear[v] = static_cast<uint16_t>(lround(x * 65535.0));
+    }
+
+    const double rgbToXyz[3][3] = {{0.412453, 0.357580, 0.180423},
+                                   {0.212671, 0.715160, 0.072169},
+                                   {0.019334, 0.119193, 0.950227}};
+    const double white[3] = {0.950456, 1.0, 1.088754};
+    for (int row = 0; row < 3; ++row) {
+      for (int col = 0; col < 3; ++col)
+        matrix[row][col] = static_cast<int32_t>(
+            lround(rgbToXyz[row][col] / white[row] * (1 << matrixBits)));
+    }
+
+    for (int i = 0; i <= cubeRootSize; ++i) {
+      double t = static_cast<double>(i) / (cubeRootSize - 1);
+      double f = t > 0.008856 ? cbrt(t) : 7.787 * t + 16.0 / 116.0;
+      cubeRoot[i] = static_cast<int32_t>(lround(f * (1 << cubeRootBits)));
+    }
+  }
+
+  // X, Y or Z over the white point as a cube-root table index.
+  int32_t index(int row, int32_t r, int32_t g, int32_t b) const {
+    int64_t sum = static_cast<int64_t>(matrix[row][0]) * r +
+                  static_cast<int64_t>(matrix[row][1]) * g +
+                  static_cast<int64_t>(matrix[row][2]) * b;
+    int32_t t = static_cast<int32_t>((sum + (1 << (matrixBits - 1))) >>
+                                     matrixBits);
+    return min(max(t, 0), cubeRootSize);
+  }
+};
+
+const LabTables &labTables() {
+  static const LabTables tables;
+  return tables;
+}
+
+// Rounds a product with a Q15 factor back to fixed-point Lab units.
+inline int16_t scaleDown(int64_t value) {
+  return static_cast<int16_t>((value + (1 << (cubeRootBits - 1))) >>
+                              cubeRootBits);
+}
+
+} // namespace
+
+LabFixedSoA bgrToLabFixed(const Mat &bgr) {
+  const LabTables &tables = labTables();
+  LabFixedSoA lab;
+  size_t n = bgr.total();
+  lab.l.resize(n);
+  lab.a.resize(n);
+  lab.b.resize(n);
+
+  size_t i = 0;
+  for (int row = 0; row < bgr.rows; ++row) {
+    const Vec3b *pixel = bgr.ptr<Vec3b>(row);
+    for (int col = 0; col < bgr.cols; ++col, ++i) {
+      int32_t b = tables.linear[pixel[col][0]];
+      int32_t g = tables.linear[pixel[col][1]];
+      int32_t r = tables.linear[pixel[col][2]];
+      int32_t fx = tables.cubeRoot[tables.index(0, r, g, b)];
+      int32_t fy = tables.cubeRoot[tables.index(1, r, g, b)];
+      int32_t fz = tables.cubeRoot[tables.index(2, r, g, b)];
+
+      lab.l[i] = scaleDown(int64_t(116 * labFixedScale) * fy -
+                           (int64_t(16 * labFixedScale) << cubeRootBits));
+      lab.a[i] = scaleDown(int64_t(500 * labFixedScale) * (fx - fy));
+      lab.b[i] = scaleDown(int64_t(200 * labFixedScale) * (fy - fz));
+    }
+  }
+  return lab;
+}
+
+void assignNearestFixed(const LabFixedSoA &points, const vector<Vec3s> &centers,
+                        int *labels) {
+  int k = static_cast<int>(centers.size());
+  size_t n = points.size();
+  if (k == 0 || n == 0)
+    return;
+
+  vector<int32_t> best(n, INT32_MAX);
+  fill(labels, labels + n, 0);
+  const int16_t *l = points.l.data();
+  const int16_t *a = points.a.data();
+  const int16_t *b = points.b.data();
+
+  // Center-outer order keeps the inner loop branch-free over contiguous
+  // int16 arrays, which the compiler vectorizes.
+  for (int c = 0; c < k; ++c) {
+    const int32_t cl = centers[c][0], ca = centers[c][1], cb = centers[c][2];
+    for (size_t i = 0; i < n; ++i) {
+      int32_t dl = l[i] - cl, da = a[i] - ca, db = b[i] - cb;
+      int32_t d = dl * dl + da * da + db * db;
+      bool closer = d < best[i];
+      best[i] = closer ? d : best[i];
+      labels[i] = closer ? c : labels[i];
+    }
+  }
+}
+
+static vector<Vec3s> seedFixedPlusPlus(const LabFixedSoA &points, int k,
+                                       mt19937 &rng, size_t sampleSize) {
+  size_t n = points.size();
+  uniform_int_distribution<size_t> pick(0, n - 1);
+  vector<Vec3s> sample(min(n, sampleSize));
+  for (size_t s = 0; s < sample.size(); ++s) {
+    size_t i = sample.size() == n ? s : pick(rng);
+    sample[s] = Vec3s(points.l[i], points.a[i], points.b[i]);
+  }
+
+  vector<Vec3s> centers;
+  uniform_int_distribution<size_t> first(0, sample.size() - 1);
+  centers.push_back(sample[first(rng)]);
+
+  vector<int64_t> minDist(sample.size());
+  for (size_t s = 0; s < sample.size(); ++s)
+    minDist[s] = labFixedDistanceSquared(sample[s], centers[0]);
+
+  uniform_real_distribution<double> unit(0.0, 1.0);
+  while (static_cast<int>(centers.size()) < k) {
+    int64_t total = 0;
+    for (int64_t d : minDist)
+      total += d;
+    if (total <= 0)
+      break;
+
+    double target = unit(rng) * static_cast<double>(total);
+    size_t chosen = sample.size() - 1;
+    for (size_t s = 0; s < sample.size(); ++s) {
+      target -= static_cast<double>(minDist[s]);
+      if (target <= 0) {
+        chosen = s;
+        break;
+      }
+    }
+    centers.push_back(sample[chosen]);
+    for (size_t s = 0; s < sample.size(); ++s)
+      minDist[s] = min<int64_t>(
+          minDist[s], labFixedDistanceSquared(sample[s], centers.back()));
+  }
+  return centers;
+}
+
+FixedKMeansResult fixedKMeans(const LabFixedSoA &points, int k,
+                              const FixedKMeansParams &params) {
+  FixedKMeansResult result;
+  size_t n = points.size();
+  if (n == 0 || k <= 0)
+    return result;
+
+  mt19937 rng(params.seed);
+  result.centers = seedFixedPlusPlus(points, k, rng, params.seedSample);
+  int centerCount = static_cast<int>(result.centers.size());
+  result.labels.resize(n);
+
+  vector<int64_t> sums(centerCount * 3);
+  vector<int64_t> counts(centerCount);
+  while (result.iterations < params.maxIterations) {
+    result.iterations++;
+    assignNearestFixed(points, result.centers, result.labels.data());
+
+    fill(sums.begin(), sums.end(), 0);
+    fill(counts.begin(), counts.end(), 0);
+    for (size_t i = 0; i < n; ++i) {
+      int c = result.labels[i];
+      sums[c * 3] += points.l[i];
+      sums[c * 3 + 1] += points.a[i];
+      sums[c * 3 + 2] += points.b[i];
+      counts[c]++;
+    }
+
+    bool moved = false;
+    for (int c = 0; c < centerCount; ++c) {
+      if (counts[c] == 0)
+        continue;
+      Vec3s center;
+      for (int ch = 0; ch < 3; ++ch)
+        center[ch] = static_cast<int16_t>(
+            lround(static_cast<double>(sums[c * 3 + ch]) / counts[c]));
+      moved = moved || center != result.centers[c];
+      result.centers[c] = center;
+    }
+    if (!moved)
+      break;
+  }
+  return result;
+}
+
+vector<Vec3f> clusterFixedColors(const LabFixedSoA &points, int k,
+                                 const FixedKMeansParams &params) {
+  FixedKMeansResult result = fixedKMeans(points, k, params);
+  if (result.labels.empty())
+    return {};
+
+  ColorHistogram histogram(min<size_t>(points.size(), 1 << 16));
+  for (size_t i = 0; i < points.size(); ++i) {
+    Vec3f color =
+        labFixedToFloat(Vec3s(points.l[i], points.a[i], points.b[i]));
+    histogram.add(clusterColorKey(result.labels[i], quantizeLab(color)));
+  }
+  return histogramModes(histogram, k);
+}
@@ -1,60 +1,383 @@
-#include "color_selector.hpp"
-#include "color_utils.hpp"
-#include "kmeans_wrapper.hpp"
-#include "template_engine.hpp"
+#include "batch.hpp"
+#include "daemon.hpp"
+#include "hooks.hpp"
+#include "palette_cache.hpp"
+#include "pipeline.hpp"
+#include "profiler.hpp"
+#include "theme_generator.hpp"
+#include "video_stream.hpp"
+#include "watcher.hpp"
 #include <cstdlib>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <memory>
 #include <nlohmann/json.hpp>
 
 using namespace std;
 using namespace cv;
 using json = nlohmann::json;
+
+static void printUsage() {
+  cerr << "Usage: ./heugen [options] <image_path>\n"
+       << "       ./heugen --batch <dir|list_file> [--output <dir>] "
+          "[--jobs N] [options]\n"
+       << "       ./heugen --batch <dir|list_file> --contact-sheet <file|-> "
+          "[--jobs N] [options]\n"
+       << "       ./heugen --daemon [options]\n"
+       << "       ./heugen --client <image_path>\n"
+       << "       ./heugen --watch [--debounce MS] [options] <image_path>\n"
+       << "       ./heugen --stream <video|gif> [--sample-fps F] "
+          "[--smoothing A] [--timeline <file>] [options]\n"
+       << "Options:\n"
+       << "  --no-cache              always recompute the palette\n"
+       << "  --engine <name>         clustering engine: opencv (default), "
+          "minibatch, seeded\n"
+       << "  --seed <n>              clustering RNG seed (same seed, same "
+          "palette)\n"
+       << "  --mode <name>           pixels (default), histogram or tiled\n"
+       << "  --fixed-point           pixels mode in 16-bit fixed-point Lab\n"
+       << "  --metric <name>         color difference for distinct selection: "
+          "cie76 (default), ciede2000, cam16ucs\n"
+       << "  --pixel-budget <n>      pixels kept by downsampling (default "
+          "40000)\n"
+       << "  --regions               also extract top, bottom, left, right "
+          "and center palettes\n"
+       << "  --region <name=x,y,w,h> extract a palette for this region "
+          "(fractions, repeatable)\n"
+       << "  --variants              also write light, contrast, colors8 "
+          "and colors32 themes\n"
+       << "  --variant <name>        write this variant's themes "
+          "(repeatable)\n"
+       << "  --profile               print per-stage wall time and "
+          "allocations\n"
+       << "  --sample-fps <f>        stream frames analysed per second "
+          "(default 2, 0 = all)\n"
+       << "  --smoothing <a>         weight of each new frame in the stream "
+          "palette (default 0.25)\n"
+       << "  --timeline <file>       write one JSON line per sampled frame\n"
+       << "  --socket <path>         daemon socket (default "
+          "$XDG_RUNTIME_DIR/huegen.sock)\n"
+       << "  --hooks <file>          reload hooks (default "
+          "~/.config/huegen/hooks.conf)\n"
+       << "  --no-hooks              run no reload hooks\n";
+}
+
+// A missing default hooks file is normal; a missing explicit one is not.
+static unique_ptr<HookDispatcher> loadDispatcher(const string &path,
+                                                 bool explicitPath) {
+  vector<Hook> hooks;
+  if (!loadHooks(path, hooks)) {
+    if (explicitPath)
+      cerr << "Warning: Could not read hooks file " << path << "\n";
+    return nullptr;
+  }
+  if (hooks.empty())
+    return nullptr;
+  return make_unique<HookDispatcher>(move(hooks));
+}
+
+static int runStreamMode(const string &path, const ExtractOptions &opts,
+                         const StreamOptions &stream, HookDispatcher *hooks) {
+  vector<Vec3f> palette;
+  StreamReport report = extractStreamPalette(path, opts, stream, palette);
+  if (!report.ok) {
+    cerr << "No frames could be decoded from: " << path << "\n";
+    return 1;
+  }
+
+  double rate =
+      report.seconds > 0 ? report.framesDecoded / report.seconds : 0.0;
+  cout << "Streamed " << report.framesDecoded << " frames ("
+       << report.framesSampled << " sampled) in " << report.seconds << "s, "
+       << rate << " frames/sec" << endl;
+
+  ThemeRun run = writeThemes(palette, defaultThemePaths());
+  if (hooks) {
+    hooks->dispatch(run.templates);
+    hooks->wait();
+  }
+  if (profiler::enabled())
+    profiler::report(cout);
+  if (!run.ok) {
+    cout << "Template processing failed!" << endl;
+    return 1;
+  }
+  cout << "Template processing completed successfully! (" << run.changedCount()
+       << " of " << run.templates.size() << " themes changed)" << endl;
+  return 0;
+}
+
+static int runBatchMode(const string &source, const string &outputDir,
+                        const string &contactSheet, const ExtractOptions &opts,
+                        unsigned jobs, PaletteCache *cache) {
+  vector<string> inputs = collectBatchInputs(source);
+  if (inputs.empty()) {
+    cerr << "No images found in: " << source << "\n";
+    return 1;
+  }
+
+  // With the sheet on stdout, the summary moves to stderr.
+  bool toStdout = contactSheet == "-";
+  ostream &log = toStdout ? cerr : cout;
+  BatchReport report;
+  if (contactSheet.empty()) {
+    report = runBatch(inputs, outputDir, opts, jobs, cache);
+  } else if (toStdout) {
+    report = runBatchStream(inputs, cout, opts, jobs, cache);
+  } else {
+    ofstream sheet(contactSheet);
+    if (!sheet.is_open()) {
+      cerr << "Error: Could not open file " << contactSheet << "\n";
+      return 1;
+    }
+    report = runBatchStream(inputs, sheet, opts, jobs, cache);
+  }
+
+  double rate = report.seconds > 0 ? report.processed / report.seconds : 0.0;
+  log << "Processed " << report.processed << " images (" << report.failed
+      << " failed) in " << report.seconds << "s, " << rate << " images/sec"
+      << endl;
+  if (cache) {
+    cache->persistStats();
+    log << "Palette cache: " << cache->hits() << " hits, " << cache->misses()
+        << " misses" << endl;
+  }
+  return report.failed == 0 ? 0 : 1;
+}
+
+// Anything else listening on the socket (or a daemon from another version)
+// may reply with a different shape; check it before reading any field.
+static bool wellFormedReply(const json &response) {
+  return response.is_object() && response.contains("ok") &&
+         response["ok"].is_boolean() && response.contains("cached") &&
+         response["cached"].is_boolean() && response.contains("ms") &&
+         response["ms"].is_number() && response.contains("changed") &&
+         response["changed"].is_array() && response.contains("templates") &&
+         response["templates"].is_number_unsigned();
+}
+
+// Exit status 2 means no daemon answered, so callers can fall back to
+// running the extraction themselves.
+static int runClient(const string &socketPath, const string &imagePath) {
+  error_code ec;
+  string absolute = filesystem::absolute(imagePath, ec).string();
+  string reply;
+  if (!sendDaemonRequest(socketPath, "extract " + (ec ? imagePath : absolute),
+                         reply)) {
+    cerr << "No daemon replied on " << socketPath << "\n";
+    return 2;
+  }
+
+  json response = json::parse(reply, nullptr, false);
+  if (!wellFormedReply(response) || !response["ok"].get<bool>()) {
+    cerr << "Daemon request failed: " << reply << "\n";
+    return 1;
+  }
+  cout << "Themes written in " << response["ms"].get<double>() << " ms ("
+       << response["changed"].size() << " of "
+       << response["templates"].get<size_t>() << " changed"
+       << (response["cached"].get<bool>() ? ", cached palette" : "") << ")"
+       << endl;
+  return 0;
+}
+
 int main(int argc, char **argv) {
-  if (argc < 2) {
-    cerr << "Usage: ./heugen <image_path>\n";
+  string imagePath;
+  string batchSource;
+  string batchOutput = "palettes";
+  bool batchOutputGiven = false;
+  string contactSheet;
+  unsigned jobs = 0;
+  bool useCache = true;
+  bool daemonMode = false;
+  bool watchMode = false;
+  int debounceMs = 200;
+  string clientImage;
+  string streamPath;
+  StreamOptions stream;
+  string socketPath = daemonSocketPath();
+  string hooksPath = defaultHooksPath();
+  bool hooksExplicit = false;
+  bool useHooks = true;
+  ExtractOptions opts;
+
+  for (int i = 1; i < argc; ++i) {
+    string arg = argv[i];
+    if (arg == "--batch" && i + 1 < argc) {
+      batchSource = argv[++i];
+    } else if (arg == "--output" && i + 1 < argc) {
+      batchOutput = argv[++i];
+      batchOutputGiven = true;
+    } else if (arg == "--contact-sheet" && i + 1 < argc) {
+      contactSheet = argv[++i];
+    } else if (arg == "--jobs" && i + 1 < argc) {
+      jobs = static_cast<unsigned>(atoi(argv[++i]));
+    } else if (arg == "--daemon") {
+      daemonMode = true;
+    } else if (arg == "--watch") {
+      watchMode = true;
+    } else if (arg == "--debounce" && i + 1 < argc) {
+      debounceMs = atoi(argv[++i]);
+    } else if (arg == "--client" && i + 1 < argc) {
+      clientImage = argv[++i];
+    } else if (arg == "--stream" && i + 1 < argc) {
+      streamPath = argv[++i];
+    } else if (arg == "--sample-fps" && i + 1 < argc) {
+      stream.sampleFps = atof(argv[++i]);
+    } else if (arg == "--smoothing" && i + 1 < argc) {
+      stream.smoothing = static_cast<float>(atof(argv[++i]));
+    } else if (arg == "--timeline" && i + 1 < argc) {
+      stream.timelinePath = argv[++i];
+    } else if (arg == "--socket" && i + 1 < argc) {
+      socketPath = argv[++i];
+    } else if (arg == "--hooks" && i + 1 < argc) {
+      hooksPath = argv[++i];
+      hooksExplicit = true;
+    } else if (arg == "--no-hooks") {
+      useHooks = false;
+    } else if (arg == "--profile") {
+      profiler::setEnabled(true);
+    } else if (arg == "--no-cache") {
+      useCache = false;
+    } else if (arg == "--engine" && i + 1 < argc) {
+      if (!parseClusterEngine(argv[++i], opts.engine)) {
+        cerr << "Unknown clustering engine: " << argv[i] << "\n";
+        return 1;
+      }
+    } else if (arg == "--seed" && i + 1 < argc) {
+      opts.seed = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 0));
+    } else if (arg == "--mode" && i + 1 < argc) {
+      if (!parseExtractMode(argv[++i], opts.mode)) {
+        cerr << "Unknown extraction mode: " << argv[i] << "\n";
+        return 1;
+      }
+    } else if (arg == "--metric" && i + 1 < argc) {
+      if (!parseDistanceMetric(argv[++i], opts.metric)) {
+        cerr << "Unknown distance metric: " << argv[i] << "\n";
+        return 1;
+      }
+    } else if (arg == "--fixed-point") {
+      opts.fixedPoint = true;
+    } else if (arg == "--pixel-budget" && i + 1 < argc) {
+      opts.pixelBudget = atol(argv[++i]);
+    } else if (arg == "--regions") {
+      const auto &defaults = defaultRegions();
+      opts.regions.insert(opts.regions.end(), defaults.begin(),
+                          defaults.end());
+    } else if (arg == "--region" && i + 1 < argc) {
+      Region region;
+      if (!parseRegion(argv[++i], region)) {
+        cerr << "Invalid region (expected name=x,y,w,h): " << argv[i] << "\n";
+        return 1;
+      }
+      opts.regions.push_back(region);
+    } else if (arg == "--variants") {
+      const auto &defaults = defaultVariants();
+      opts.variants.insert(opts.variants.end(), defaults.begin(),
+                           defaults.end());
+    } else if (arg == "--variant" && i + 1 < argc) {
+      PaletteVariant variant;
+      if (!findVariant(argv[++i], variant)) {
+        cerr << "Unknown palette variant: " << argv[i] << "\n";
+        return 1;
+      }
+      opts.variants.push_back(variant);
+    } else if (!arg.empty() && arg[0] != '-' && imagePath.empty()) {
+      imagePath = arg;
+    } else {
+      printUsage();
+      return 1;
+    }
+  }
+
+  // Both only shape batch output; anywhere else they would be ignored.
+  if (batchSource.empty() && (batchOutputGiven || !contactSheet.empty())) {
+    cerr << "--output and --contact-sheet require --batch\n";
+    return 1;
+  }
+
+  if (!clientImage.empty())
+    return runClient(socketPath, clientImage);
+
+  // Region palettes count cluster labels over the float Lab pixels of the
+  // budget-sized image, which only the plain pixels path produces.
+  if (!opts.regions.empty() &&
+      (opts.mode != ExtractMode::Pixels || opts.fixedPoint)) {
+    cerr << "--regions requires --mode pixels without --fixed-point\n";
     return 1;
   }
-  Mat img = imread(argv[1]);
-  if (img.empty()) {
-    cerr << "Failed to load image: " << argv[1] << "\n";
+  // extractRegionPalettes and extractVariantPalettes each run their own
+  // clustering pass, and streams and batches write neither.
+  bool extraPalettes = !opts.regions.empty() || !opts.variants.empty();
+  if (!opts.regions.empty() && !opts.variants.empty()) {
+    cerr << "--variants cannot be combined with --regions\n";
     return 1;
   }
-  resize(img, img, Size(200, 200));
-  img.convertTo(img, CV_32F, 1.0 / 255.0);
-  Mat lab;
-  cvtColor(img, lab, COLOR_BGR2Lab);
-  auto allColors = extractClusterColors(lab, 32);
-  vector<Vec3f> filtered;
-  for (const auto &c : allColors) {
-    if (c[0] > 30.0f)
-      filtered.push_back(c);
+  if (extraPalettes && (!streamPath.empty() || !batchSource.empty())) {
+    cerr << "--regions and --variants cannot be combined with --stream or "
+            "--batch\n";
+    return 1;
   }
-  auto distinctColors = selectMostDistinctColors(filtered, 16);
-  sort(distinctColors.begin(), distinctColors.end(),
-       [](const Vec3f &a, const Vec3f &b) {
-         return calculateSaturation(a) > calculateSaturation(b);
-       });
 
-  nlohmann::json colorJson = colorsToJson(distinctColors);
+  // Batch mode writes palettes, not themes, so it never fires hooks.
+  unique_ptr<HookDispatcher> hooks;
+  if (useHooks && batchSource.empty())
+    hooks = loadDispatcher(hooksPath, hooksExplicit);
 
-  std::string templateDir =
-      std::string(std::getenv("HOME")) + "/.config/huegen/templates/";
-  std::string outputDir =
-      std::string(std::getenv("HOME")) + "/.config/huegen/themes/";
+  // Every frame is new content, so streams bypass the palette cache.
+  if (!streamPath.empty())
+    return runStreamMode(streamPath, opts, stream, hooks.get());
+
+  unique_ptr<PaletteCache> cache;
+  if (useCache)
+    cache = make_unique<PaletteCache>();
+
+  if (!batchSource.empty()) {
+    int status = runBatchMode(batchSource, batchOutput, contactSheet, opts,
+                              jobs, cache.get());
+    if (profiler::enabled())
+      profiler::report(contactSheet == "-" ? cerr : cout);
+    return status;
+  }
 
-  bool success = processTemplates(colorJson, templateDir, outputDir);
-  std::string outputFile = outputDir + "colors.json";
-  std::ofstream file(outputFile);
-  if (!file.is_open()) {
-    std::cerr << "Error: Could not open file " << outputDir << "\n";
+  if (daemonMode)
+    return runDaemon(socketPath, opts, cache.get(), defaultThemePaths(),
+                     hooks.get());
+
+  if (imagePath.empty()) {
+    printUsage();
     return 1;
   }
 
-  file << colorJson.dump(4); // Pretty-print with 4-space indentation
-  file.close();
+  if (watchMode)
+    return runWatch(imagePath, opts, cache.get(), defaultThemePaths(),
+                    debounceMs, hooks.get());
+
+  ThemeRun run = generateThemes(imagePath, opts, cache.get(),
+                                defaultThemePaths());
+  if (hooks)
+    hooks->dispatch(run.templates);
+  if (cache) {
+    auto totals = cache->persistStats();
+    cout << "Palette cache " << (run.cached ? "hit" : "miss") << " ("
+         << totals.first << " hits, " << totals.second << " misses total)"
+         << endl;
+  }
+
+  if (profiler::enabled()) {
+    profiler::report(cout);
+    cout << "total: " << run.seconds * 1000.0 << " ms" << endl;
+  }
+
+  // Reloads overlap the report above but finish before we exit.
+  if (hooks)
+    hooks->wait();
 
-  if (success) {
-    cout << "Template processing completed successfully!" << endl;
+  if (run.ok) {
+    cout << "Template processing completed successfully! ("
+         << run.changedCount() << " of " << run.templates.size()
+         << " themes changed)" << endl;
   } else {
     cout << "Template processing failed!" << endl;
     return 1;
@@ -0,0 +1,488 @@
+#include "minibatch_kmeans.hpp"
+#include "color_histogram.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <random>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+using namespace cv;
+
+void LabSoA::reserve(size_t n) {
+  l.reserve(n);
+  a.reserve(n);
+  b.reserve(n);
+}
+
+void LabSoA::push(const Vec3f &c) {
+  l.push_back(c[0]);
+  a.push_back(c[1]);
+  b.push_back(c[2]);
+}
+
+LabSoA LabSoA::fromMat(const Mat &lab) {
+  LabSoA soa;
+  size_t n = lab.total();
+  soa.l.resize(n);
+  soa.a.resize(n);
+  soa.b.resize(n);
+  size_t i = 0;
+  for (int row = 0; row < lab.rows; ++row) {
+    const Vec3f *pixel = lab.ptr<Vec3f>(row);
+    for (int col = 0; col < lab.cols; ++col, ++i) {
+      soa.l[i] = pixel[col][0];
+      soa.a[i] = pixel[col][1];
+      soa.b[i] = pixel[col][2];
+    }
+  }
+  return soa;
+}
+
+// Plain multiply/add (no FMA) in every path so the vector and scalar kernels
+// agree bit for bit and labels do not depend on the instruction set. The
+// build compiles this file with -ffp-contract=off, which stops the compiler
+// from fusing them under -march=native.
+static void assignScalar(const float *l, const float *a, const float *b,
+                         size_t begin, size_t end, const float *cl,
+                         const float *ca, const float *cb, int k,
+                         int *labels) {
+  for (size_t i = begin; i < end; ++i) {
+    float best = FLT_MAX;
+    int bestIndex = 0;
+    for (int c = 0; c < k; ++c) {
+      float dl = l[i] - cl[c];
+      float da = a[i] - ca[c];
+      float db = b[i] - cb[c];
+      float d = dl * dl + da * da + db * db;
+      if (d < best) {
+        best = d;
+        bestIndex = c;
+      }
+    }
+    labels[i] = bestIndex;
+  }
+}
+
+void assignNearest(const LabSoA &points, const vector<Vec3f> &centers,
+                   int *labels) {
+  int k = static_cast<int>(centers.size());
+  size_t n = points.size();
+  if (k == 0 || n == 0)
+    return;
+
+  vector<float> cl(k), ca(k), cb(k);
+  for (int c = 0; c < k; ++c) {
+    cl[c] = centers[c][0];
+    ca[c] = centers[c][1];
+    cb[c] = centers[c][2];
+  }
+
+  const float *l = points.l.data();
+  const float *a = points.a.data();
+  const float *b = points.b.data();
+  size_t i = 0;
+
+#if defined(__AVX2__)
+  for (; i + 8 <= n; i += 8) {
+    __m256 pl = _mm256_loadu_ps(l + i);
+    __m256 pa = _mm256_loadu_ps(a + i);
+    __m256 pb = _mm256_loadu_ps(b + i);
+    __m256 best = _mm256_set1_ps(FLT_MAX);
+    __m256i bestIndex = _mm256_setzero_si256();
+    for (int c = 0; c < k; ++c) {
+      __m256 dl = _mm256_sub_ps(pl, _mm256_set1_ps(cl[c]));
+      __m256 da = _mm256_sub_ps(pa, _mm256_set1_ps(ca[c]));
+      __m256 db = _mm256_sub_ps(pb, _mm256_set1_ps(cb[c]));
+      __m256 d = _mm256_add_ps(
+          _mm256_add_ps(_mm256_mul_ps(dl, dl), _mm256_mul_ps(da, da)),
+          _mm256_mul_ps(db, db));
+      __m256 closer = _mm256_cmp_ps(d, best, _CMP_LT_OQ);
+      best = _mm256_blendv_ps(best, d, closer);
+      bestIndex = _mm256_blendv_epi8(bestIndex, _mm256_set1_epi32(c),
+                                     _mm256_castps_si256(closer));
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(labels + i), bestIndex);
+  }
+#elif defined(__SSE2__)
+  for (; i + 4 <= n; i += 4) {
+    __m128 pl = _mm_loadu_ps(l + i);
+    __m128 pa = _mm_loadu_ps(a + i);
+    __m128 pb = _mm_loadu_ps(b + i);
+    __m128 best = _mm_set1_ps(FLT_MAX);
+    __m128i bestIndex = _mm_setzero_si128();
+    for (int c = 0; c < k; ++c) {
+      __m128 dl = _mm_sub_ps(pl, _mm_set1_ps(cl[c]));
+      __m128 da = _mm_sub_ps(pa, _mm_set1_ps(ca[c]));
+      __m128 db = _mm_sub_ps(pb, _mm_set1_ps(cb[c]));
+      __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dl, dl), _mm_mul_ps(da, da)),
+                            _mm_mul_ps(db, db));
+      __m128 closer = _mm_cmplt_ps(d, best);
+      __m128i mask = _mm_castps_si128(closer);
+      best = _mm_or_ps(_mm_and_ps(closer, d), _mm_andnot_ps(closer, best));
+      bestIndex = _mm_or_si128(_mm_and_si128(mask, _mm_set1_epi32(c)),
+                               _mm_andnot_si128(mask, bestIndex));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(labels + i), bestIndex);
+  }
+#endif
+
+  assignScalar(l, a, b, i, n, cl.data(), ca.data(), cb.data(), k, labels);
+}
+
+static float squaredDistance(const LabSoA &p, size_t i, const Vec3f &c) {
+  float dl = p.l[i] - c[0];
+  float da = p.a[i] - c[1];
+  float db = p.b[i] - c[2];
+  return dl * dl + da * da + db * db;
+}
+
+static vector<Vec3f> seedPlusPlus(const LabSoA &points, int k, mt19937 &rng,
+                                  size_t sampleSize) {
+  size_t n = points.size();
+  uniform_int_distribution<size_t> pick(0, n - 1);
+  vector<size_t> sample(min(n, sampleSize));
+  if (sample.size() == n) {
+    for (size_t i = 0; i < n; ++i)
+      sample[i] = i;
+  } else {
+    for (auto &s : sample)
+      s = pick(rng);
+  }
+
+  auto at = [&](size_t s) {
+    size_t i = sample[s];
+    return Vec3f(points.l[i], points.a[i], points.b[i]);
+  };
+
+  vector<Vec3f> centers;
+  uniform_int_distribution<size_t> first(0, sample.size() - 1);
+  centers.push_back(at(first(rng)));
+
+  vector<float> minDist(sample.size());
+  for (size_t s = 0; s < sample.size(); ++s)
+    minDist[s] = squaredDistance(points, sample[s], centers[0]);
+
+  uniform_real_distribution<double> unit(0.0, 1.0);
+  while (static_cast<int>(centers.size()) < k) {
+    double total = 0;
+    for (float d : minDist)
+      total += d;
+    if (total <= 0)
+      break;
+
+    double target = unit(rng) * total;
+    size_t chosen = sample.size() - 1;
+    for (size_t s = 0; s < sample.size(); ++s) {
+      target -= minDist[s];
+      if (target <= 0) {
+        chosen = s;
+        break;
+      }
+    }
+
+    centers.push_back(at(chosen));
+    for (size_t s = 0; s < sample.size(); ++s)
+      minDist[s] =
+          min(minDist[s], squaredDistance(points, sample[s], centers.back()));
+  }
+
+  // Fewer distinct colors than k: duplicate centers simply stay empty.
+  while (static_cast<int>(centers.size()) < k)
+    centers.push_back(centers.back());
+  return centers;
+}
+
+// Mini-batch updates from `centers` until they settle. `prior` is the number
+// of points each center is assumed to already represent, which damps the
+// first updates of warm-started centers.
+static KMeansResult refineMiniBatch(const LabSoA &points, vector<Vec3f> centers,
+                                    int prior, mt19937 &rng,
+                                    const MiniBatchParams &params) {
+  KMeansResult result;
+  size_t n = points.size();
+  int k = static_cast<int>(centers.size());
+  size_t batchSize = min<size_t>(params.batchSize, n);
+
+  vector<int> counts(k, prior);
+  LabSoA batch;
+  batch.l.resize(batchSize);
+  batch.a.resize(batchSize);
+  batch.b.resize(batchSize);
+  vector<int> batchLabels(batchSize);
+  vector<Vec3f> previous;
+  uniform_int_distribution<size_t> pick(0, n - 1);
+
+  int iteration = 0;
+  while (iteration < params.maxIterations) {
+    ++iteration;
+    for (size_t j = 0; j < batchSize; ++j) {
+      size_t i = pick(rng);
+      batch.l[j] = points.l[i];
+      batch.a[j] = points.a[i];
+      batch.b[j] = points.b[i];
+    }
+    assignNearest(batch, centers, batchLabels.data());
+
+    previous = centers;
+    for (size_t j = 0; j < batchSize; ++j) {
+      int c = batchLabels[j];
+      float eta = 1.0f / ++counts[c];
+      centers[c][0] += eta * (batch.l[j] - centers[c][0]);
+      centers[c][1] += eta * (batch.a[j] - centers[c][1]);
+      centers[c][2] += eta * (batch.b[j] - centers[c][2]);
+    }
+
+    float maxShift = 0;
+    for (int c = 0; c < k; ++c) {
+      Vec3f d = centers[c] - previous[c];
+      maxShift = max(maxShift, d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+    }
+    if (maxShift <= params.tolerance * params.tolerance)
+      break;
+  }
+
+  result.labels.resize(n);
+  assignNearest(points, centers, result.labels.data());
+  result.centers = move(centers);
+  result.iterations = iteration;
+  return result;
+}
+
+KMeansResult miniBatchKMeans(const LabSoA &points, int k,
+                             const MiniBatchParams &params) {
+  size_t n = points.size();
+  if (n == 0 || k <= 0)
+    return KMeansResult();
+
+  mt19937 rng(params.seed);
+  size_t batchSize = min<size_t>(params.batchSize, n);
+  vector<Vec3f> centers =
+      seedPlusPlus(points, k, rng, max<size_t>(batchSize * 4, k * 64));
+  return refineMiniBatch(points, move(centers), 0, rng, params);
+}
+
+KMeansResult miniBatchKMeans(const LabSoA &points,
+                             vector<Vec3f> initialCenters,
+                             const MiniBatchParams &params) {
+  size_t n = points.size();
+  if (n == 0 || initialCenters.empty())
+    return KMeansResult();
+
+  mt19937 rng(params.seed);
+  int prior = static_cast<int>(min<size_t>(params.batchSize, n) /
+                               initialCenters.size());
+  return refineMiniBatch(points, move(initialCenters), prior, rng, params);
+}
+
+static vector<Vec3f> seedWeightedPlusPlus(const LabSoA &points,
+                                          const vector<float> &weights, int k,
+                                          mt19937 &rng) {
+  size_t n = points.size();
+  auto at = [&](size_t i) {
+    return Vec3f(points.l[i], points.a[i], points.b[i]);
+  };
+  uniform_real_distribution<double> unit(0.0, 1.0);
+
+  auto pickWeighted = [&](const vector<double> &mass, double total) {
+    double target = unit(rng) * total;
+    for (size_t i = 0; i < n; ++i) {
+      target -= mass[i];
+      if (target <= 0)
+        return i;
+    }
+    return n - 1;
+  };
+
+  vector<double> mass(weights.begin(), weights.end());
+  double total = 0;
+  for (double m : mass)
+    total += m;
+
+  vector<Vec3f> centers;
+  centers.push_back(at(pickWeighted(mass, total)));
+  vector<float> minDist(n);
+  for (size_t i = 0; i < n; ++i)
+    minDist[i] = squaredDistance(points, i, centers[0]);
+
+  while (static_cast<int>(centers.size()) < k) {
+    total = 0;
+    for (size_t i = 0; i < n; ++i) {
+      mass[i] = static_cast<double>(weights[i]) * minDist[i];
+      total += mass[i];
+    }
+    if (total <= 0)
+      break;
+
+    centers.push_back(at(pickWeighted(mass, total)));
+    for (size_t i = 0; i < n; ++i)
+      minDist[i] = min(minDist[i], squaredDistance(points, i, centers.back()));
+  }
+
+  while (static_cast<int>(centers.size()) < k)
+    centers.push_back(centers.back());
+  return centers;
+}
+
+KMeansResult weightedKMeans(const LabSoA &points, const vector<float> &weights,
+                            int k, const WeightedKMeansParams &params) {
+  KMeansResult result;
+  size_t n = points.size();
+  if (n == 0 || k <= 0)
+    return result;
+
+  mt19937 rng(params.seed);
+  vector<Vec3f> centers = seedWeightedPlusPlus(points, weights, k, rng);
+  result.labels.resize(n);
+
+  vector<double> sumL(k), sumA(k), sumB(k), mass(k);
+  int iteration = 0;
+  while (iteration < params.maxIterations) {
+    ++iteration;
+    assignNearest(points, centers, result.labels.data());
+
+    fill(sumL.begin(), sumL.end(), 0.0);
+    fill(sumA.begin(), sumA.end(), 0.0);
+    fill(sumB.begin(), sumB.end(), 0.0);
+    fill(mass.begin(), mass.end(), 0.0);
+    for (size_t i = 0; i < n; ++i) {
+      int c = result.labels[i];
+      double w = weights[i];
+      sumL[c] += w * points.l[i];
+      sumA[c] += w * points.a[i];
+      sumB[c] += w * points.b[i];
+      mass[c] += w;
+    }
+
+    float maxShift = 0;
+    for (int c = 0; c < k; ++c) {
+      if (mass[c] <= 0)
+        continue;
+      Vec3f updated(static_cast<float>(sumL[c] / mass[c]),
+                    static_cast<float>(sumA[c] / mass[c]),
+                    static_cast<float>(sumB[c] / mass[c]));
+      Vec3f d = updated - centers[c];
+      maxShift = max(maxShift, d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+      centers[c] = updated;
+    }
+    if (maxShift <= params.tolerance * params.tolerance)
+      break;
+  }
+
+  assignNearest(points, centers, result.labels.data());
+  result.centers = move(centers);
+  result.iterations = iteration;
+  return result;
+}
+
+// Lloyd passes from `centers` until the labels stop changing, no center moves
+// more than the tolerance, or maxIterations. Sums are accumulated in point
+// order in double precision, so the result does not depend on threading.
+static KMeansResult refineLloyd(const LabSoA &points, vector<Vec3f> centers,
+                                const SeededKMeansParams &params) {
+  KMeansResult result;
+  size_t n = points.size();
+  int k = static_cast<int>(centers.size());
+  vector<int> &labels = result.labels;
+  labels.resize(n);
+  vector<int> previous;
+
+  vector<double> sumL(k), sumA(k), sumB(k);
+  vector<size_t> count(k);
+  int iteration = 0;
+  for (;;) {
+    assignNearest(points, centers, labels.data());
+    if (labels == previous || iteration == params.maxIterations)
+      break;
+    ++iteration;
+
+    fill(sumL.begin(), sumL.end(), 0.0);
+    fill(sumA.begin(), sumA.end(), 0.0);
+    fill(sumB.begin(), sumB.end(), 0.0);
+    fill(count.begin(), count.end(), 0);
+    for (size_t i = 0; i < n; ++i) {
+      int c = labels[i];
+      sumL[c] += points.l[i];
+      sumA[c] += points.a[i];
+      sumB[c] += points.b[i];
+      count[c]++;
+    }
+
+    float maxShift = 0;
+    for (int c = 0; c < k; ++c) {
+      if (count[c] == 0)
+        continue;
+      Vec3f updated(static_cast<float>(sumL[c] / count[c]),
+                    static_cast<float>(sumA[c] / count[c]),
+                    static_cast<float>(sumB[c] / count[c]));
+      Vec3f d = updated - centers[c];
+      maxShift = max(maxShift, d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+      centers[c] = updated;
+    }
+    if (maxShift <= params.tolerance * params.tolerance) {
+      assignNearest(points, centers, labels.data());
+      break;
+    }
+    previous.swap(labels);
+    labels.resize(n);
+  }
+
+  result.centers = move(centers);
+  result.iterations = iteration;
+  return result;
+}
+
+KMeansResult seededKMeans(const LabSoA &points, int k,
+                          const SeededKMeansParams &params) {
+  size_t n = points.size();
+  if (n == 0 || k <= 0)
+    return KMeansResult();
+
+  // Coarse histogram; 11 bits per channel as in quantizeLab().
+  float scale = 1.0f / params.cellSize;
+  auto cell = [&](float v) {
+    return static_cast<uint64_t>(floor(v * scale) + labQuantOffset) & 0x7ff;
+  };
+  ColorHistogram histogram(min<size_t>(n, 1 << 14));
+  for (size_t i = 0; i < n; ++i)
+    histogram.add((cell(points.l[i]) << 22) | (cell(points.a[i]) << 11) |
+                  cell(points.b[i]));
+
+  // Key order, so the seeding does not depend on the hash table layout.
+  vector<pair<uint64_t, int>> cells;
+  histogram.forEach(
+      [&](uint64_t key, int count) { cells.emplace_back(key, count); });
+  sort(cells.begin(), cells.end());
+
+  LabSoA cellColors;
+  vector<float> weights;
+  cellColors.reserve(cells.size());
+  weights.reserve(cells.size());
+  auto center = [&](uint64_t index) {
+    return (static_cast<float>(index) - labQuantOffset + 0.5f) *
+           params.cellSize;
+  };
+  for (const auto &entry : cells) {
+    uint64_t key = entry.first;
+    cellColors.push(Vec3f(center((key >> 22) & 0x7ff),
+                          center((key >> 11) & 0x7ff), center(key & 0x7ff)));
+    weights.push_back(static_cast<float>(entry.second));
+  }
+
+  WeightedKMeansParams seeding;
+  seeding.seed = params.seed;
+  KMeansResult seeds = weightedKMeans(cellColors, weights, k, seeding);
+  return refineLloyd(points, move(seeds.centers), params);
+}
+
+KMeansResult seededKMeans(const LabSoA &points, vector<Vec3f> initialCenters,
+                          const SeededKMeansParams &params) {
+  if (points.size() == 0 || initialCenters.empty())
+    return KMeansResult();
+  return refineLloyd(points, move(initialCenters), params);
+}
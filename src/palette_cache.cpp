@@ -0,0 +1,185 @@
+#include "palette_cache.hpp"
+#include "file_utils.hpp"
+#include "hash_utils.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <nlohmann/json.hpp>
+#include <sys/file.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace std;
+using namespace cv;
+using json = nlohmann::json;
+namespace fs = std::filesystem;
+
+// 2: keys fingerprint the image (see fingerprintFile) instead of hashing it.
+static const int cacheFormatVersion = 2;
+
+PaletteCache::PaletteCache(const string &directory, size_t maxEntries)
+    : directory_(directory), maxEntries_(maxEntries) {
+  error_code ec;
+  fs::create_directories(directory_, ec);
+}
+
+string PaletteCache::defaultDirectory() {
+  const char *xdg = getenv("XDG_CACHE_HOME");
+  if (xdg && *xdg)
+    return string(xdg) + "/huegen/palettes";
+  const char *home = getenv("HOME");
+  return string(home ? home : ".") + "/.cache/huegen/palettes";
+}
+
+string PaletteCache::keyFor(const string &imagePath,
+                            const ExtractOptions &opts) const {
+  uint64_t contentHash;
+  if (!fingerprintFile(imagePath, contentHash))
+    return "";
+  string params = optionsSignature(opts);
+  return hashToHex(contentHash) +
+         hashToHex(hashBytes(params.data(), params.size(), cacheFormatVersion));
+}
+
+bool PaletteCache::lookup(const string &key, vector<Vec3f> &palette) {
+  string path = directory_ + "/" + key + ".json";
+  ifstream file(path);
+  if (!file.is_open()) {
+    misses_++;
+    return false;
+  }
+
+  try {
+    json entry = json::parse(file);
+    vector<Vec3f> colors;
+    for (const auto &c : entry.at("lab"))
+      colors.emplace_back(c.at(0).get<float>(), c.at(1).get<float>(),
+                          c.at(2).get<float>());
+    palette = move(colors);
+  } catch (const exception &) {
+    misses_++;
+    return false;
+  }
+
+  // Refresh the timestamp so eviction keeps recently used palettes.
+  error_code ec;
+  fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+  hits_++;
+  return true;
+}
+
+void PaletteCache::store(const string &key, const vector<Vec3f> &palette) {
+  json entry;
+  entry["version"] = cacheFormatVersion;
+  entry["lab"] = json::array();
+  for (const auto &c : palette)
+    entry["lab"].push_back({c[0], c[1], c[2]});
+
+  string path = directory_ + "/" + key + ".json";
+  string tmpPath = path + ".tmp" + to_string(getpid()) + "-" +
+                   to_string(hash<thread::id>()(this_thread::get_id()));
+  {
+    ofstream file(tmpPath);
+    if (!file.is_open())
+      return;
+    file << entry.dump();
+  }
+  error_code ec;
+  bool replacing = fs::exists(path, ec);
+  fs::rename(tmpPath, path, ec);
+  if (ec) {
+    fs::remove(tmpPath, ec);
+    return;
+  }
+
+  evict(!replacing);
+}
+
+static vector<pair<fs::file_time_type, fs::path>>
+listEntries(const string &directory) {
+  vector<pair<fs::file_time_type, fs::path>> entries;
+  error_code ec;
+  for (const auto &entry : fs::directory_iterator(directory, ec)) {
+    if (entry.path().extension() == ".json" &&
+        entry.path().filename() != "stats.json")
+      entries.emplace_back(entry.last_write_time(ec), entry.path());
+  }
+  return entries;
+}
+
+void PaletteCache::evict(bool added) {
+  lock_guard<mutex> lock(evictMutex_);
+  if (!entriesCounted_) {
+    entryCount_ = listEntries(directory_).size();
+    entriesCounted_ = true;
+  } else if (added) {
+    entryCount_++;
+  }
+  if (entryCount_ <= maxEntries_)
+    return;
+
+  vector<pair<fs::file_time_type, fs::path>> entries = listEntries(directory_);
+  entryCount_ = entries.size();
+  if (entries.size() <= maxEntries_)
+    return;
+
+  // Trim to 7/8 of the limit, so a full cache is rescanned once every
+  // maxEntries_ / 8 new palettes rather than on every store.
+  sort(entries.begin(), entries.end());
+  size_t excess = entries.size() - (maxEntries_ - maxEntries_ / 8);
+  error_code ec;
+  for (size_t i = 0; i < excess; ++i) {
+    if (fs::remove(entries[i].second, ec))
+      entryCount_--;
+  }
+}
+
+// Exclusive flock on a file, released with the descriptor on scope exit.
+namespace {
+struct FileLock {
+  int fd;
+  explicit FileLock(const string &path)
+      : fd(::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644)) {
+    if (fd >= 0 && flock(fd, LOCK_EX) < 0) {
+      close(fd);
+      fd = -1;
+    }
+  }
+  ~FileLock() {
+    if (fd >= 0)
+      close(fd);
+  }
+};
+} // namespace
+
+pair<size_t, size_t> PaletteCache::persistStats() {
+  lock_guard<mutex> lock(statsMutex_);
+  string path = directory_ + "/stats.json";
+  // Batch runs, the daemon and the watcher may update the totals at once:
+  // serialize the read-modify-write on a lock file (stats.json itself is
+  // replaced by rename, so it cannot carry the lock).
+  FileLock fileLock(directory_ + "/stats.lock");
+  size_t hits = hits_, misses = misses_;
+  size_t totalHits = hits - persistedHits_;
+  size_t totalMisses = misses - persistedMisses_;
+
+  ifstream in(path);
+  if (in.is_open()) {
+    try {
+      json stats = json::parse(in);
+      totalHits += stats.value("hits", size_t(0));
+      totalMisses += stats.value("misses", size_t(0));
+    } catch (const exception &) {
+    }
+  }
+
+  string stats = json{{"hits", totalHits}, {"misses", totalMisses}}.dump();
+  if (fileLock.fd >= 0 && writeFileAtomic(path, stats) != WriteResult::Failed) {
+    // Only what reached the file; a failed write is retried next call.
+    persistedHits_ = hits;
+    persistedMisses_ = misses;
+  }
+  return {totalHits, totalMisses};
+}
@@ -0,0 +1,148 @@
+#include "palette_file.hpp"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+// Holds an open descriptor and releases it (and its flock) on scope exit.
+struct FileDescriptor {
+  int fd;
+  ~FileDescriptor() {
+    if (fd >= 0)
+      close(fd);
+  }
+};
+
+bool validLayout(const PaletteFileLayout *layout) {
+  return layout->magic == paletteFileMagic &&
+         layout->version == paletteFileVersion &&
+         layout->count <= paletteFileEntries;
+}
+
+} // namespace
+
+bool writePaletteFile(const string &path, const PaletteFileEntry *entries,
+                      uint16_t count) {
+  if (count > paletteFileEntries)
+    count = paletteFileEntries;
+
+  FileDescriptor file{::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644)};
+  if (file.fd < 0 || flock(file.fd, LOCK_EX) < 0) {
+    cerr << "Error: Could not open " << path << ": " << strerror(errno)
+         << "\n";
+    return false;
+  }
+
+  struct stat info;
+  bool fresh = fstat(file.fd, &info) == 0 &&
+               info.st_size != static_cast<off_t>(sizeof(PaletteFileLayout));
+  if (fresh && ftruncate(file.fd, sizeof(PaletteFileLayout)) < 0) {
+    cerr << "Error: Could not resize " << path << ": " << strerror(errno)
+         << "\n";
+    return false;
+  }
+
+  void *mapping = mmap(nullptr, sizeof(PaletteFileLayout),
+                       PROT_READ | PROT_WRITE, MAP_SHARED, file.fd, 0);
+  if (mapping == MAP_FAILED) {
+    cerr << "Error: Could not map " << path << ": " << strerror(errno) << "\n";
+    return false;
+  }
+  auto *layout = static_cast<PaletteFileLayout *>(mapping);
+
+  if (fresh || !validLayout(layout)) {
+    layout->magic = paletteFileMagic;
+    layout->version = paletteFileVersion;
+    layout->count = 0;
+    layout->generation.store(0, memory_order_relaxed);
+    memset(layout->entries, 0, sizeof(layout->entries));
+  }
+
+  // An odd generation under our flock means a writer died mid-update:
+  // rewrite even if the entries happen to match, or readers spin forever.
+  uint64_t generation = layout->generation.load(memory_order_relaxed);
+  bool interrupted = generation % 2 != 0;
+  bool changed =
+      interrupted || layout->count != count ||
+      memcmp(layout->entries, entries, count * sizeof(PaletteFileEntry)) != 0;
+  if (changed) {
+    if (interrupted)
+      generation++;
+    layout->generation.store(generation + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memset(layout->entries, 0, sizeof(layout->entries));
+    memcpy(layout->entries, entries, count * sizeof(PaletteFileEntry));
+    layout->count = count;
+    layout->generation.store(generation + 2, memory_order_release);
+  }
+
+  munmap(mapping, sizeof(PaletteFileLayout));
+  return true;
+}
+
+PaletteFileReader::~PaletteFileReader() {
+  if (layout_)
+    munmap(const_cast<PaletteFileLayout *>(layout_),
+           sizeof(PaletteFileLayout));
+}
+
+bool PaletteFileReader::open(const string &path) {
+  FileDescriptor file{::open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+  struct stat info;
+  if (file.fd < 0 || fstat(file.fd, &info) < 0 ||
+      info.st_size < static_cast<off_t>(sizeof(PaletteFileLayout)))
+    return false;
+
+  void *mapping = mmap(nullptr, sizeof(PaletteFileLayout), PROT_READ,
+                       MAP_SHARED, file.fd, 0);
+  if (mapping == MAP_FAILED)
+    return false;
+  auto *layout = static_cast<const PaletteFileLayout *>(mapping);
+  if (!validLayout(layout)) {
+    munmap(mapping, sizeof(PaletteFileLayout));
+    return false;
+  }
+
+  if (layout_)
+    munmap(const_cast<PaletteFileLayout *>(layout_),
+           sizeof(PaletteFileLayout));
+  layout_ = layout;
+  return true;
+}
+
+uint64_t PaletteFileReader::generation() const {
+  return layout_ ? layout_->generation.load(memory_order_acquire) : 0;
+}
+
+bool PaletteFileReader::read(PaletteSnapshot &snapshot) const {
+  if (!layout_)
+    return false;
+  // A writer holds the odd generation for microseconds; one that stays odd
+  // belongs to a writer that died, and the next write repairs it even when
+  // its entries are unchanged.
+  for (int attempt = 0; attempt < 1000; ++attempt) {
+    uint64_t before = layout_->generation.load(memory_order_acquire);
+    if (before % 2 != 0) {
+      usleep(100);
+      continue;
+    }
+    uint16_t count = layout_->count;
+    memcpy(snapshot.entries, layout_->entries, sizeof(snapshot.entries));
+    atomic_thread_fence(memory_order_acquire);
+    if (layout_->generation.load(memory_order_relaxed) != before)
+      continue;
+
+    snapshot.generation = before;
+    snapshot.count = count <= paletteFileEntries ? count : paletteFileEntries;
+    return true;
+  }
+  return false;
+}
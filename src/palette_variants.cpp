@@ -0,0 +1,66 @@
+#include "palette_variants.hpp"
+#include "color_selector.hpp"
+#include "color_utils.hpp"
+#include <algorithm>
+
+using namespace std;
+using namespace cv;
+
+const vector<PaletteVariant> &defaultVariants() {
+  static const vector<PaletteVariant> variants = {
+      {"light", 0.0f, 70.0f, 16},
+      {"contrast", 62.0f, 100.0f, 16},
+      {"colors8", 30.0f, 100.0f, 8},
+      {"colors32", 30.0f, 100.0f, 32},
+  };
+  return variants;
+}
+
+bool findVariant(const string &name, PaletteVariant &variant) {
+  for (const PaletteVariant &candidate : defaultVariants()) {
+    if (candidate.name == name) {
+      variant = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Lightness distance from `variant`'s range; 0 inside it.
+static float rangeGap(const Vec3f &color, const PaletteVariant &variant) {
+  if (color[0] <= variant.minLightness)
+    return variant.minLightness - color[0];
+  return max(0.0f, color[0] - variant.maxLightness);
+}
+
+vector<Vec3f> selectVariant(const vector<Vec3f> &candidates,
+                            const DistanceMatrix &distances,
+                            const PaletteVariant &variant) {
+  vector<size_t> inRange, outside;
+  for (size_t i = 0; i < candidates.size(); ++i) {
+    float l = candidates[i][0];
+    if (l > variant.minLightness && l <= variant.maxLightness)
+      inRange.push_back(i);
+    else
+      outside.push_back(i);
+  }
+
+  vector<Vec3f> colors;
+  for (size_t index : selectMostDistinctIndices(candidates, inRange,
+                                                variant.colors, distances))
+    colors.push_back(candidates[index]);
+
+  stable_sort(outside.begin(), outside.end(), [&](size_t a, size_t b) {
+    return rangeGap(candidates[a], variant) < rangeGap(candidates[b], variant);
+  });
+  for (size_t index : outside) {
+    if (colors.size() >= static_cast<size_t>(variant.colors))
+      break;
+    colors.push_back(candidates[index]);
+  }
+
+  sort(colors.begin(), colors.end(), [](const Vec3f &a, const Vec3f &b) {
+    return calculateSaturation(a) > calculateSaturation(b);
+  });
+  return colors;
+}
@@ -0,0 +1,275 @@
+#include "pipeline.hpp"
+#include "color_selector.hpp"
+#include "color_utils.hpp"
+#include "histogram_clustering.hpp"
+#include "lab_fixed.hpp"
+#include "minibatch_kmeans.hpp"
+#include "preprocess.hpp"
+#include "profiler.hpp"
+#include "tiled_pipeline.hpp"
+
+using namespace std;
+using namespace cv;
+
+bool parseExtractMode(const string &name, ExtractMode &mode) {
+  if (name == "pixels") {
+    mode = ExtractMode::Pixels;
+  } else if (name == "histogram") {
+    mode = ExtractMode::Histogram;
+  } else if (name == "tiled") {
+    mode = ExtractMode::Tiled;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char *extractModeName(ExtractMode mode) {
+  switch (mode) {
+  case ExtractMode::Histogram:
+    return "histogram";
+  case ExtractMode::Tiled:
+    return "tiled";
+  case ExtractMode::Pixels:
+  default:
+    return "pixels";
+  }
+}
+
+string optionsSignature(const ExtractOptions &opts) {
+  string signature = "k=" + to_string(opts.clusters) +
+                     ";minL=" + to_string(opts.minLightness) +
+                     ";n=" + to_string(opts.colors) +
+                     ";mode=" + extractModeName(opts.mode);
+  if (opts.seed != defaultClusterSeed)
+    signature += ";seed=" + to_string(opts.seed);
+  if (opts.metric != DistanceMetric::CIE76)
+    signature += string(";metric=") + distanceMetricName(opts.metric);
+  if (opts.mode == ExtractMode::Histogram)
+    return signature + ";bits=" + to_string(opts.histogramBits);
+  if (opts.mode == ExtractMode::Tiled)
+    return signature;
+  signature += ";budget=" + to_string(opts.pixelBudget);
+  if (opts.fixedPoint)
+    return signature + ";fixed";
+  return signature + ";engine=" + clusterEngineName(opts.engine);
+}
+
+static Mat toBudgetLab(const Mat &bgr, long pixelBudget) {
+  Mat img = downsampleToBudget(bgr, pixelBudget);
+  Mat lab;
+  profiler::Stage stage("cvtColor");
+  img.convertTo(img, CV_32F, 1.0 / 255.0);
+  cvtColor(img, lab, COLOR_BGR2Lab);
+  return lab;
+}
+
+// Pixels-mode clustering of a budget-sized Lab image; the iterations the
+// engine reports show up under --profile.
+static vector<Vec3f> clusterLab(const Mat &lab, const ExtractOptions &opts) {
+  profiler::Stage stage("extractClusterColors");
+  ClusterStats stats;
+  vector<Vec3f> colors = extractClusterColors(lab, opts.clusters, opts.engine,
+                                              opts.seed, &stats);
+  if (stats.iterations > 0)
+    profiler::count("kmeansIterations", stats.iterations);
+  return colors;
+}
+
+static vector<Vec3f> clusterColors(const Mat &bgr, const ExtractOptions &opts) {
+  if (opts.mode == ExtractMode::Histogram) {
+    profiler::Stage stage("extractHistogramColors");
+    return extractHistogramColors(bgr, opts.clusters, opts.histogramBits,
+                                  opts.seed);
+  }
+  if (opts.mode == ExtractMode::Tiled) {
+    profiler::Stage stage("extractTiledColors");
+    TileParams params;
+    params.seed = opts.seed;
+    return extractTiledColors(bgr, opts.clusters, params);
+  }
+  if (opts.fixedPoint) {
+    Mat img = downsampleToBudget(bgr, opts.pixelBudget);
+    LabFixedSoA lab;
+    {
+      profiler::Stage stage("cvtColor");
+      lab = bgrToLabFixed(img);
+    }
+    profiler::Stage stage("extractClusterColors");
+    FixedKMeansParams params;
+    params.seed = opts.seed;
+    return clusterFixedColors(lab, opts.clusters, params);
+  }
+
+  return clusterLab(toBudgetLab(bgr, opts.pixelBudget), opts);
+}
+
+// Lightness filter, distinct selection and saturation order shared by every
+// extraction path.
+static vector<Vec3f> selectPalette(const vector<Vec3f> &allColors,
+                                   const ExtractOptions &opts) {
+  profiler::Stage stage("selectMostDistinctColors");
+  vector<Vec3f> filtered;
+  for (const auto &c : allColors) {
+    if (c[0] > opts.minLightness)
+      filtered.push_back(c);
+  }
+  vector<Vec3f> distinctColors;
+  if (opts.metric == DistanceMetric::CIE76) {
+    distinctColors = selectMostDistinctColors(filtered, opts.colors);
+  } else {
+    DistanceMatrix distances(filtered, opts.metric);
+    distinctColors = selectMostDistinctColors(filtered, opts.colors, distances);
+  }
+  sort(distinctColors.begin(), distinctColors.end(),
+       [](const Vec3f &a, const Vec3f &b) {
+         return calculateSaturation(a) > calculateSaturation(b);
+       });
+  return distinctColors;
+}
+
+// selectPalette over candidates whose distance matrix is already built; the
+// same picks, without building a second matrix.
+static vector<Vec3f> selectPalette(const vector<Vec3f> &candidates,
+                                   const DistanceMatrix &distances,
+                                   const ExtractOptions &opts) {
+  profiler::Stage stage("selectMostDistinctColors");
+  vector<size_t> filtered;
+  for (size_t i = 0; i < candidates.size(); ++i) {
+    if (candidates[i][0] > opts.minLightness)
+      filtered.push_back(i);
+  }
+  vector<Vec3f> distinctColors;
+  for (size_t index :
+       selectMostDistinctIndices(candidates, filtered, opts.colors, distances))
+    distinctColors.push_back(candidates[index]);
+  sort(distinctColors.begin(), distinctColors.end(),
+       [](const Vec3f &a, const Vec3f &b) {
+         return calculateSaturation(a) > calculateSaturation(b);
+       });
+  return distinctColors;
+}
+
+vector<Vec3f> extractPalette(const Mat &bgr, const ExtractOptions &opts) {
+  return selectPalette(clusterColors(bgr, opts), opts);
+}
+
+vector<Vec3f> extractFramePalette(const Mat &bgr, const ExtractOptions &opts,
+                                  vector<Vec3f> &centers) {
+  Mat lab = toBudgetLab(bgr, opts.pixelBudget);
+  vector<Vec3f> allColors;
+  {
+    profiler::Stage stage("extractClusterColors");
+    allColors = extractClusterColorsWarm(lab, opts.clusters, opts.engine,
+                                         centers, opts.seed);
+  }
+  return selectPalette(allColors, opts);
+}
+
+bool extractPaletteFromFile(const string &path, const ExtractOptions &opts,
+                            vector<Vec3f> &palette) {
+  long budget = opts.mode == ExtractMode::Pixels ? opts.pixelBudget : 0;
+  Mat img = loadImage(path, budget);
+  if (img.empty())
+    return false;
+  palette = extractPalette(img, opts);
+  return true;
+}
+
+// Palette of one region: the clusters covering at least 1% of it, most common
+// first, through the usual selection, then padded from the whole-image
+// palette so every colorN a template uses still resolves.
+static vector<Vec3f> regionPalette(const vector<Vec3f> &candidates,
+                                   const vector<int> &counts,
+                                   const vector<Vec3f> &palette,
+                                   const ExtractOptions &opts) {
+  long total = 0;
+  for (int count : counts)
+    total += count;
+
+  vector<size_t> order;
+  for (size_t i = 0; i < counts.size(); ++i) {
+    if (counts[i] > 0 && counts[i] * 100L >= total)
+      order.push_back(i);
+  }
+  stable_sort(order.begin(), order.end(),
+              [&](size_t a, size_t b) { return counts[a] > counts[b]; });
+
+  vector<Vec3f> present;
+  for (size_t i : order)
+    present.push_back(candidates[i]);
+  vector<Vec3f> colors = selectPalette(present, opts);
+
+  for (const Vec3f &color : palette) {
+    if (colors.size() >= palette.size())
+      break;
+    if (find(colors.begin(), colors.end(), color) == colors.end())
+      colors.push_back(color);
+  }
+  return colors;
+}
+
+vector<Vec3f> extractRegionPalettes(const Mat &bgr, const ExtractOptions &opts,
+                                    vector<RegionPalette> &regions) {
+  Mat lab = toBudgetLab(bgr, opts.pixelBudget);
+  vector<Vec3f> candidates = clusterLab(lab, opts);
+  vector<Vec3f> palette = selectPalette(candidates, opts);
+
+  regions.clear();
+  if (candidates.empty())
+    return palette;
+
+  profiler::Stage stage("regionPalettes");
+  vector<int> labels(lab.total());
+  assignNearest(LabSoA::fromMat(lab), candidates, labels.data());
+  RegionStatistics statistics(labels.data(), lab.rows, lab.cols,
+                              static_cast<int>(candidates.size()));
+
+  vector<int> counts;
+  for (const Region &region : opts.regions) {
+    statistics.clusterCounts(statistics.toPixels(region), counts);
+    regions.push_back(
+        {region.name, regionPalette(candidates, counts, palette, opts)});
+  }
+  return palette;
+}
+
+bool extractRegionPalettesFromFile(const string &path,
+                                   const ExtractOptions &opts,
+                                   vector<Vec3f> &palette,
+                                   vector<RegionPalette> &regions) {
+  Mat img = loadImage(path, opts.pixelBudget);
+  if (img.empty())
+    return false;
+  palette = extractRegionPalettes(img, opts, regions);
+  return true;
+}
+
+vector<Vec3f> extractVariantPalettes(const Mat &bgr, const ExtractOptions &opts,
+                                     vector<VariantPalette> &variants) {
+  ExtractOptions clustering = opts;
+  for (const PaletteVariant &variant : opts.variants)
+    clustering.clusters = max(clustering.clusters, variant.colors);
+  vector<Vec3f> candidates = clusterColors(bgr, clustering);
+  DistanceMatrix distances(candidates, opts.metric);
+  vector<Vec3f> palette = selectPalette(candidates, distances, opts);
+
+  profiler::Stage stage("variantPalettes");
+  variants.clear();
+  for (const PaletteVariant &variant : opts.variants)
+    variants.push_back(
+        {variant.name, selectVariant(candidates, distances, variant)});
+  return palette;
+}
+
+bool extractVariantPalettesFromFile(const string &path,
+                                    const ExtractOptions &opts,
+                                    vector<Vec3f> &palette,
+                                    vector<VariantPalette> &variants) {
+  long budget = opts.mode == ExtractMode::Pixels ? opts.pixelBudget : 0;
+  Mat img = loadImage(path, budget);
+  if (img.empty())
+    return false;
+  palette = extractVariantPalettes(img, opts, variants);
+  return true;
+}
@@ -0,0 +1,135 @@
+#include "preprocess.hpp"
+#include "profiler.hpp"
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+
+using namespace std;
+using namespace cv;
+
+static uint32_t readBigEndian(const unsigned char *p, int bytes) {
+  uint32_t v = 0;
+  for (int i = 0; i < bytes; ++i)
+    v = (v << 8) | p[i];
+  return v;
+}
+
+static bool probePng(ifstream &file, Size &size) {
+  unsigned char header[24];
+  file.seekg(0);
+  if (!file.read(reinterpret_cast<char *>(header), sizeof(header)))
+    return false;
+  if (header[0] != 0x89 || header[1] != 'P' || header[2] != 'N' ||
+      header[3] != 'G' || string(header + 12, header + 16) != "IHDR")
+    return false;
+  size = Size(readBigEndian(header + 16, 4), readBigEndian(header + 20, 4));
+  return true;
+}
+
+static bool probeJpeg(ifstream &file, Size &size) {
+  unsigned char marker[2];
+  file.seekg(0);
+  if (!file.read(reinterpret_cast<char *>(marker), 2) || marker[0] != 0xFF ||
+      marker[1] != 0xD8)
+    return false;
+
+  while (file.read(reinterpret_cast<char *>(marker), 2)) {
+    if (marker[0] != 0xFF)
+      return false;
+    if (marker[1] == 0xFF) {
+      // Fill byte; the marker code follows.
+      file.seekg(-1, ios::cur);
+      continue;
+    }
+
+    unsigned char length[2];
+    if (!file.read(reinterpret_cast<char *>(length), 2))
+      return false;
+    uint32_t segment = readBigEndian(length, 2);
+
+    // SOF0..SOF15, excluding DHT (C4), JPG (C8) and DAC (CC).
+    unsigned char code = marker[1];
+    if (code >= 0xC0 && code <= 0xCF && code != 0xC4 && code != 0xC8 &&
+        code != 0xCC) {
+      unsigned char frame[5];
+      if (!file.read(reinterpret_cast<char *>(frame), sizeof(frame)))
+        return false;
+      size = Size(readBigEndian(frame + 3, 2), readBigEndian(frame + 1, 2));
+      return true;
+    }
+    if (segment < 2)
+      return false;
+    file.seekg(segment - 2, ios::cur);
+  }
+  return false;
+}
+
+bool probeImageSize(const string &path, Size &size) {
+  ifstream file(path, ios::binary);
+  if (!file.is_open())
+    return false;
+  if (probePng(file, size))
+    return true;
+  file.clear();
+  return probeJpeg(file, size);
+}
+
+int reducedDecodeFactor(const Size &size, long pixelBudget) {
+  if (pixelBudget <= 0)
+    return 1;
+  int factor = 1;
+  while (factor < 8) {
+    long reduced = static_cast<long>(size.width / (factor * 2)) *
+                   (size.height / (factor * 2));
+    if (reduced < pixelBudget)
+      break;
+    factor *= 2;
+  }
+  return factor;
+}
+
+Mat downsampleToBudget(const Mat &bgr, long pixelBudget) {
+  long pixels = static_cast<long>(bgr.cols) * bgr.rows;
+  if (pixelBudget <= 0 || pixels <= pixelBudget)
+    return bgr;
+
+  double scale = sqrt(static_cast<double>(pixelBudget) / pixels);
+  Size target(max(1, static_cast<int>(bgr.cols * scale)),
+              max(1, static_cast<int>(bgr.rows * scale)));
+  profiler::Stage stage("resize");
+  Mat small;
+  resize(bgr, small, target, 0, 0, INTER_AREA);
+  return small;
+}
+
+Mat loadImage(const string &path, long pixelBudget) {
+  // Only libjpeg scales during decode; other formats would be fully decoded
+  // and then shrunk bilinearly, so they go through downsampleToBudget.
+  int flags = IMREAD_COLOR;
+  Size size;
+  ifstream file(path, ios::binary);
+  if (pixelBudget > 0 && file.is_open() && probeJpeg(file, size)) {
+    switch (reducedDecodeFactor(size, pixelBudget)) {
+    case 2:
+      flags = IMREAD_REDUCED_COLOR_2;
+      break;
+    case 4:
+      flags = IMREAD_REDUCED_COLOR_4;
+      break;
+    case 8:
+      flags = IMREAD_REDUCED_COLOR_8;
+      break;
+    }
+  }
+
+  file.close();
+
+  Mat img;
+  {
+    profiler::Stage stage("imread");
+    img = imread(path, flags);
+  }
+  if (img.empty())
+    return img;
+  return downsampleToBudget(img, pixelBudget);
+}
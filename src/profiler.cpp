@@ -0,0 +1,198 @@
+#include "profiler.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <mutex>
+#include <new>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+atomic<uint64_t> allocCount{0};
+atomic<uint64_t> allocBytes{0};
+atomic<bool> profilingEnabled{false};
+
+struct StageTotals {
+  string name;
+  uint64_t calls = 0;
+  int64_t ns = 0;
+  uint64_t allocs = 0;
+  uint64_t bytes = 0;
+};
+
+struct CounterTotals {
+  string name;
+  uint64_t samples = 0;
+  int64_t sum = 0;
+  int64_t max = 0;
+};
+
+mutex stagesMutex;
+vector<StageTotals> &stages() {
+  static vector<StageTotals> totals;
+  return totals;
+}
+
+vector<CounterTotals> &counters() {
+  static vector<CounterTotals> totals;
+  return totals;
+}
+
+int64_t nowNs() {
+  return chrono::duration_cast<chrono::nanoseconds>(
+             chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void *countedAlloc(size_t size) {
+  allocCount.fetch_add(1, memory_order_relaxed);
+  allocBytes.fetch_add(size, memory_order_relaxed);
+  void *p = malloc(size ? size : 1);
+  if (!p)
+    throw bad_alloc();
+  return p;
+}
+
+void *countedAlignedAlloc(size_t size, align_val_t align) {
+  allocCount.fetch_add(1, memory_order_relaxed);
+  allocBytes.fetch_add(size, memory_order_relaxed);
+  size_t alignment = static_cast<size_t>(align);
+  size_t rounded = (size + alignment - 1) / alignment * alignment;
+  void *p = aligned_alloc(alignment, rounded ? rounded : alignment);
+  if (!p)
+    throw bad_alloc();
+  return p;
+}
+} // namespace
+
+// Counting replacements for the global allocation functions. They only bump
+// two relaxed counters, so they stay enabled even without --profile. OpenCV
+// allocates Mat data with cv::fastMalloc, which bypasses them.
+void *operator new(size_t size) { return countedAlloc(size); }
+void *operator new[](size_t size) { return countedAlloc(size); }
+void *operator new(size_t size, const nothrow_t &) noexcept {
+  try {
+    return countedAlloc(size);
+  } catch (...) {
+    return nullptr;
+  }
+}
+void *operator new[](size_t size, const nothrow_t &) noexcept {
+  try {
+    return countedAlloc(size);
+  } catch (...) {
+    return nullptr;
+  }
+}
+void *operator new(size_t size, align_val_t align) {
+  return countedAlignedAlloc(size, align);
+}
+void *operator new[](size_t size, align_val_t align) {
+  return countedAlignedAlloc(size, align);
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+void operator delete(void *p, const nothrow_t &) noexcept { free(p); }
+void operator delete[](void *p, const nothrow_t &) noexcept { free(p); }
+void operator delete(void *p, align_val_t) noexcept { free(p); }
+void operator delete[](void *p, align_val_t) noexcept { free(p); }
+void operator delete(void *p, size_t, align_val_t) noexcept { free(p); }
+void operator delete[](void *p, size_t, align_val_t) noexcept { free(p); }
+
+namespace profiler {
+
+void setEnabled(bool enabled) { profilingEnabled = enabled; }
+
+bool enabled() { return profilingEnabled; }
+
+AllocStats allocations() {
+  return {allocCount.load(memory_order_relaxed),
+          allocBytes.load(memory_order_relaxed)};
+}
+
+Stage::Stage(const char *name) : name_(nullptr), startNs_(0) {
+  if (!profilingEnabled)
+    return;
+  name_ = name;
+  startAllocs_ = allocations();
+  startNs_ = nowNs();
+}
+
+Stage::~Stage() {
+  if (!name_)
+    return;
+  int64_t elapsed = nowNs() - startNs_;
+  AllocStats end = allocations();
+
+  lock_guard<mutex> lock(stagesMutex);
+  auto &totals = stages();
+  auto it = totals.begin();
+  while (it != totals.end() && it->name != name_)
+    ++it;
+  if (it == totals.end()) {
+    totals.push_back({name_});
+    it = totals.end() - 1;
+  }
+  it->calls++;
+  it->ns += elapsed;
+  it->allocs += end.count - startAllocs_.count;
+  it->bytes += end.bytes - startAllocs_.bytes;
+}
+
+void count(const char *name, int64_t value) {
+  if (!profilingEnabled)
+    return;
+  lock_guard<mutex> lock(stagesMutex);
+  auto &totals = counters();
+  auto it = totals.begin();
+  while (it != totals.end() && it->name != name)
+    ++it;
+  if (it == totals.end()) {
+    totals.push_back({name});
+    it = totals.end() - 1;
+  }
+  it->max = it->samples == 0 ? value : std::max(it->max, value);
+  it->samples++;
+  it->sum += value;
+}
+
+void report(ostream &out) {
+  lock_guard<mutex> lock(stagesMutex);
+  ios::fmtflags flags = out.flags();
+  out << left << setw(26) << "stage" << right << setw(7) << "calls"
+      << setw(12) << "ms" << setw(12) << "new allocs" << setw(12)
+      << "new KiB" << "\n";
+  for (const auto &s : stages()) {
+    out << left << setw(26) << s.name << right << setw(7) << s.calls
+        << setw(12) << fixed << setprecision(3) << s.ns / 1e6 << setw(12)
+        << s.allocs << setw(12) << setprecision(1) << s.bytes / 1024.0
+        << "\n";
+  }
+  out << "(new allocs/KiB: C++ operator new only; cv::Mat buffers from "
+         "cv::fastMalloc are not counted)\n";
+  if (!counters().empty()) {
+    out << left << setw(26) << "counter" << right << setw(7) << "samples"
+        << setw(12) << "mean" << setw(10) << "max" << "\n";
+    for (const auto &c : counters()) {
+      out << left << setw(26) << c.name << right << setw(7) << c.samples
+          << setw(12) << fixed << setprecision(1)
+          << static_cast<double>(c.sum) / c.samples << setw(10) << c.max
+          << "\n";
+    }
+  }
+  out.flags(flags);
+}
+
+void reset() {
+  lock_guard<mutex> lock(stagesMutex);
+  stages().clear();
+  counters().clear();
+}
+
+} // namespace profiler
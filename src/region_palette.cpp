@@ -0,0 +1,92 @@
+#include "region_palette.hpp"
+#include <cstdio>
+
+using namespace std;
+using namespace cv;
+
+const vector<Region> &defaultRegions() {
+  static const vector<Region> regions = {
+      {"top", 0.0f, 0.0f, 1.0f, 0.05f},
+      {"bottom", 0.0f, 0.95f, 1.0f, 0.05f},
+      {"left", 0.0f, 0.0f, 0.1f, 1.0f},
+      {"right", 0.9f, 0.0f, 0.1f, 1.0f},
+      {"center", 0.25f, 0.25f, 0.5f, 0.5f},
+  };
+  return regions;
+}
+
+bool parseRegion(const string &spec, Region &region) {
+  size_t equals = spec.find('=');
+  if (equals == string::npos || equals == 0)
+    return false;
+  string name = spec.substr(0, equals);
+  for (char c : name) {
+    if (!isRegionNameChar(c))
+      return false;
+  }
+  if (name.compare(0, 5, "color") == 0)
+    return false;
+
+  Region parsed;
+  parsed.name = name;
+  int consumed = 0;
+  if (sscanf(spec.c_str() + equals + 1, "%f,%f,%f,%f%n", &parsed.x, &parsed.y,
+             &parsed.width, &parsed.height, &consumed) != 4 ||
+      spec.size() != equals + 1 + consumed)
+    return false;
+  if (parsed.x < 0 || parsed.y < 0 || parsed.width <= 0 ||
+      parsed.height <= 0 || parsed.x + parsed.width > 1.0001f ||
+      parsed.y + parsed.height > 1.0001f)
+    return false;
+
+  region = parsed;
+  return true;
+}
+
+RegionStatistics::RegionStatistics(const int *labels, int rows, int cols,
+                                   int clusters)
+    : rows_(rows), cols_(cols), clusters_(clusters),
+      table_(static_cast<size_t>(rows + 1) * (cols + 1) * clusters, 0) {
+  // S(r + 1, c + 1) = S(r, c + 1) + counts of row r up to column c.
+  vector<int32_t> rowCounts(clusters);
+  for (int row = 0; row < rows; ++row) {
+    fill(rowCounts.begin(), rowCounts.end(), 0);
+    const int *label = labels + static_cast<size_t>(row) * cols;
+    for (int col = 0; col < cols; ++col) {
+      int cluster = label[col];
+      if (cluster >= 0 && cluster < clusters)
+        rowCounts[cluster]++;
+      const int32_t *above = table_.data() + offset(row, col + 1);
+      int32_t *cell = table_.data() + offset(row + 1, col + 1);
+      for (int k = 0; k < clusters; ++k)
+        cell[k] = above[k] + rowCounts[k];
+    }
+  }
+}
+
+Rect RegionStatistics::toPixels(const Region &region) const {
+  int x0 = static_cast<int>(lround(region.x * cols_));
+  int y0 = static_cast<int>(lround(region.y * rows_));
+  int x1 = static_cast<int>(lround((region.x + region.width) * cols_));
+  int y1 = static_cast<int>(lround((region.y + region.height) * rows_));
+  x0 = min(max(x0, 0), max(cols_ - 1, 0));
+  y0 = min(max(y0, 0), max(rows_ - 1, 0));
+  x1 = min(max(x1, x0 + 1), cols_);
+  y1 = min(max(y1, y0 + 1), rows_);
+  return Rect(x0, y0, x1 - x0, y1 - y0);
+}
+
+void RegionStatistics::clusterCounts(const Rect &rect,
+                                     vector<int> &counts) const {
+  counts.assign(clusters_, 0);
+  if (rect.width <= 0 || rect.height <= 0)
+    return;
+  const int32_t *table = table_.data();
+  const int32_t *topLeft = table + offset(rect.y, rect.x);
+  const int32_t *topRight = table + offset(rect.y, rect.x + rect.width);
+  const int32_t *bottomLeft = table + offset(rect.y + rect.height, rect.x);
+  const int32_t *bottomRight =
+      table + offset(rect.y + rect.height, rect.x + rect.width);
+  for (int k = 0; k < clusters_; ++k)
+    counts[k] = bottomRight[k] - topRight[k] - bottomLeft[k] + topLeft[k];
+}
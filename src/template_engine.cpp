@@ -1,46 +1,62 @@
 #include "template_engine.hpp"
+#include "file_utils.hpp"
+#include "region_palette.hpp"
+#include "thread_pool.hpp"
 #include <algorithm>
 #include <filesystem> // Add this
 #include <fstream>    // Add this
 #include <iomanip>
-#include <regex> // Add this
+#include <mutex>
 #include <sstream>
+#include <unordered_map>
 
 using namespace std;
 using namespace cv;
 using json = nlohmann::json;
 namespace fs = std::filesystem; // Add this
 
+// Rounds a float triple to the integers shown in hsl/hsv/lab strings.
+static void roundTriple(const Vec3f &color, int values[3]) {
+  for (int c = 0; c < 3; ++c)
+    values[c] = (int)round(color[c]);
+}
+
 json colorsToJson(const vector<Vec3f> &labColors) {
   json result = json::object();
+  size_t count = labColors.size();
+
+  // Scratch space reused by every palette serialized on this thread
+  thread_local vector<Vec3b> rgbColors;
+  thread_local vector<Vec3f> hslColors, hsvColors;
+  rgbColors.resize(count);
+  hslColors.resize(count);
+  hsvColors.resize(count);
+
+  // Convert every color at once: LAB to RGB, then RGB to HSL and HSV
+  labToRgbBatch(labColors.data(), rgbColors.data(), count);
+  rgbToHslHsvBatch(rgbColors.data(), hslColors.data(), hsvColors.data(),
+                   count);
+
+  char buffer[kColorStringCapacity];
+  auto text = [&](char *end) { return string(buffer, end); };
 
-  for (size_t i = 0; i < labColors.size(); ++i) {
-    const Vec3f &labColor = labColors[i];
-    // Convert LAB to BGR then to RGB
-    Vec3b bgrColor = labToBgr(labColor);
-    Vec3b rgbColor = bgrToRgb(bgrColor);
-    // Calculate other color formats
-    Vec3f hslColor = rgbToHsl(rgbColor);
-    Vec3f hsvColor = rgbToHsv(rgbColor);
-    string colorKey = "color" + to_string(i);
-    result[colorKey] = {
-        {"hex", formatHex(rgbColor)},
-        {"strip", strip(rgbColor)},
-        {"rgb", "rgb(" + to_string(rgbColor[0]) + ", " +
-                    to_string(rgbColor[1]) + ", " + to_string(rgbColor[2]) +
-                    ")"},
-        {"rgba", "rgba(" + to_string(rgbColor[0]) + ", " +
-                     to_string(rgbColor[1]) + ", " + to_string(rgbColor[2]) +
-                     ", 1.0)"},
-        {"hsl", "hsl(" + to_string((int)round(hslColor[0])) + ", " +
-                    to_string((int)round(hslColor[1])) + "%, " +
-                    to_string((int)round(hslColor[2])) + "%)"},
-        {"hsv", "hsv(" + to_string((int)round(hsvColor[0])) + ", " +
-                    to_string((int)round(hsvColor[1])) + "%, " +
-                    to_string((int)round(hsvColor[2])) + "%)"},
-        {"lab", "lab(" + to_string((int)round(labColor[0])) + ", " +
-                    to_string((int)round(labColor[1])) + ", " +
-                    to_string((int)round(labColor[2])) + ")"}};
+  for (size_t i = 0; i < count; ++i) {
+    const Vec3b &rgbColor = rgbColors[i];
+    int rgb[3] = {rgbColor[0], rgbColor[1], rgbColor[2]};
+    int hsl[3], hsv[3], lab[3];
+    roundTriple(hslColors[i], hsl);
+    roundTriple(hsvColors[i], hsv);
+    roundTriple(labColors[i], lab);
+
+    json &entry = result["color" + to_string(i)];
+    entry["hex"] = text(formatHexTo(buffer, rgbColor));
+    entry["strip"] = text(formatHexTo(buffer, rgbColor, false));
+    entry["rgb"] = text(formatColorFunctionTo(buffer, "rgb", rgb));
+    entry["rgba"] =
+        text(formatColorFunctionTo(buffer, "rgba", rgb, "", ", 1.0)"));
+    entry["hsl"] = text(formatColorFunctionTo(buffer, "hsl", hsl, "%"));
+    entry["hsv"] = text(formatColorFunctionTo(buffer, "hsv", hsv, "%"));
+    entry["lab"] = text(formatColorFunctionTo(buffer, "lab", lab));
   }
   return result;
 }
@@ -50,8 +66,29 @@ string colorsToJsonString(const vector<Vec3f> &labColors, int indent) {
   return colorJson.dump(indent);
 }
 
+TemplateResult processTemplate(const string &templatePath,
+                               const string &outputDir,
+                               const PaletteValues &palette) {
+  TemplateResult result;
+  fs::path inputPath(templatePath);
+  result.name = inputPath.stem().string(); // Remove .tlp extension
+  result.outputPath = outputDir + "/" + result.name;
+
+  // Compiled once per template and reused until the file changes
+  auto compiled = loadCompiledTemplate(templatePath);
+  if (!compiled)
+    return result;
+
+  string content = renderTemplate(*compiled, palette);
+  WriteResult written = writeFileAtomic(result.outputPath, content);
+  result.ok = written != WriteResult::Failed;
+  result.changed = written == WriteResult::Written;
+  return result;
+}
+
 bool processTemplates(const json &colorJson, const string &inputDir,
-                      const string &outputDir) {
+                      const string &outputDir,
+                      vector<TemplateResult> *report) {
   try {
     // Create output directory if it doesn't exist
     if (!fs::exists(outputDir)) {
@@ -59,40 +96,33 @@ bool processTemplates(const json &colorJson, const string &inputDir,
     }
 
     // Find all .tlp files in input directory
+    vector<fs::path> templates;
     for (const auto &entry : fs::directory_iterator(inputDir)) {
-      if (entry.path().extension() == ".tlp") {
-        string inputPath = entry.path().string();
-        string filename = entry.path().stem().string(); // Remove .tlp extension
-        string outputPath = outputDir + "/" + filename;
-
-        // Read template file
-        ifstream inputFile(inputPath);
-        if (!inputFile.is_open()) {
-          cerr << "Error: Could not open template file: " << inputPath << endl;
-          continue;
-        }
-
-        string content((istreambuf_iterator<char>(inputFile)),
-                       istreambuf_iterator<char>());
-        inputFile.close();
-
-        // Replace color placeholders
-        string processedContent = replaceColorPlaceholders(content, colorJson);
-
-        // Write output file
-        ofstream outputFile(outputPath);
-        if (!outputFile.is_open()) {
-          cerr << "Error: Could not create output file: " << outputPath << endl;
-          continue;
-        }
-
-        outputFile << processedContent;
-        outputFile.close();
-
-        cout << "Processed: " << filename << endl;
+      if (entry.path().extension() == ".tlp")
+        templates.push_back(entry.path());
+    }
+    sort(templates.begin(), templates.end());
+
+    PaletteValues palette(colorJson);
+    vector<TemplateResult> results(templates.size());
+
+    auto renderOne = [&](size_t i) {
+      results[i] = processTemplate(templates[i].string(), outputDir, palette);
+    };
+
+    ThreadPool::shared().parallelFor(templates.size(), renderOne);
+
+    for (const auto &result : results) {
+      if (!result.ok) {
+        cerr << "Error: Could not process template: " << result.name << endl;
+      } else {
+        cout << "Processed: " << result.name
+             << (result.changed ? "" : " (unchanged)") << endl;
       }
     }
 
+    if (report)
+      *report = move(results);
     return true;
 
   } catch (const exception &e) {
@@ -101,57 +131,237 @@ bool processTemplates(const json &colorJson, const string &inputDir,
   }
 }
 
-string replaceColorPlaceholders(const string &content, const json &colorJson) {
-  string result = content;
-
-  // Create regex pattern to match {colorN.property} placeholders
-  regex colorPattern(R"(\{(color\d+)\.([^}]+)\})");
-  sregex_iterator iter(content.begin(), content.end(), colorPattern);
-  sregex_iterator end;
-
-  // Process matches in reverse order to avoid position shifts
-  vector<pair<size_t, pair<size_t, string>>> replacements;
-
-  for (auto it = iter; it != end; ++it) {
-    smatch match = *it;
-    string colorKey = match[1].str(); // e.g., "color0"
-    string property = match[2].str(); // e.g., "hex"
-
-    // Check if the color and property exist in JSON
-    if (colorJson.contains(colorKey) &&
-        colorJson[colorKey].contains(property)) {
-      string replacement;
-
-      // Handle different property types
-      if (colorJson[colorKey][property].is_string()) {
-        replacement = colorJson[colorKey][property].get<string>();
-      } else if (colorJson[colorKey][property].is_number()) {
-        replacement = to_string(colorJson[colorKey][property].get<double>());
-      } else if (colorJson[colorKey][property].is_object()) {
-        // For nested objects like rgb_values.r
-        replacement = colorJson[colorKey][property].dump();
-      }
+const vector<string> &templateProperties() {
+  static const vector<string> properties = {"hex", "strip", "rgb", "rgba",
+                                            "hsl", "hsv",   "lab"};
+  return properties;
+}
 
-      //      replacements.push_back({match.position(), {match.length(),
-      //      replacement}});
-      replacements.push_back(
-          {static_cast<size_t>(match.position()),
-           {static_cast<size_t>(match.length()), replacement}});
-    } else {
-      cerr << "Warning: Color placeholder not found: {" << colorKey << "."
-           << property << "}" << endl;
+static int propertyIndex(const string &name) {
+  const auto &properties = templateProperties();
+  auto it = find(properties.begin(), properties.end(), name);
+  return it == properties.end() ? -1 : int(it - properties.begin());
+}
+
+// Index N of a "colorN" key, or -1 unless N is written canonically (so that
+// "color01" keeps resolving to the literal JSON key, as before).
+static int colorIndex(const string &key) {
+  if (key.size() <= 5 || key.size() > 14 || key.compare(0, 5, "color") != 0)
+    return -1;
+  string digits = key.substr(5);
+  if (digits.size() > 1 && digits[0] == '0')
+    return -1;
+  int index = 0;
+  for (char c : digits) {
+    if (c < '0' || c > '9')
+      return -1;
+    index = index * 10 + (c - '0');
+  }
+  return index;
+}
+
+// Value of colorJson[colorKey][property] as a replacement string.
+static bool lookupPlaceholder(const json &colorJson, const string &colorKey,
+                              const string &property, string &replacement) {
+  auto color = colorJson.find(colorKey);
+  if (color == colorJson.end() || !color->is_object())
+    return false;
+  auto value = color->find(property);
+  if (value == color->end())
+    return false;
+
+  replacement.clear();
+  if (value->is_string()) {
+    replacement = value->get<string>();
+  } else if (value->is_number()) {
+    replacement = to_string(value->get<double>());
+  } else if (value->is_object()) {
+    // For nested objects like rgb_values.r
+    replacement = value->dump();
+  }
+  return true;
+}
+
+CompiledTemplate compileTemplate(const string &content) {
+  CompiledTemplate compiled;
+  compiled.source = content;
+  const string &src = compiled.source;
+
+  // Matches {colorN.property}: an optional region name and '.', "color", one
+  // or more digits, '.', then one or more characters up to the next '}'.
+  size_t literalStart = 0;
+  size_t pos = src.find('{');
+  while (pos != string::npos) {
+    size_t keyStart = pos + 1;
+    if (src.compare(keyStart, 5, "color") != 0) {
+      size_t scopeEnd = keyStart;
+      while (scopeEnd < src.size() && isRegionNameChar(src[scopeEnd]))
+        ++scopeEnd;
+      if (scopeEnd > keyStart && scopeEnd < src.size() && src[scopeEnd] == '.')
+        keyStart = scopeEnd + 1;
+    }
+
+    size_t digitsStart = keyStart + 5;
+    size_t digitsEnd = digitsStart;
+    if (src.compare(keyStart, 5, "color") == 0) {
+      while (digitsEnd < src.size() && isdigit((unsigned char)src[digitsEnd]))
+        ++digitsEnd;
     }
+
+    size_t close = string::npos;
+    if (digitsEnd > digitsStart && digitsEnd < src.size() &&
+        src[digitsEnd] == '.')
+      close = src.find('}', digitsEnd + 1);
+
+    if (close == string::npos || close == digitsEnd + 1) {
+      pos = src.find('{', pos + 1);
+      continue;
+    }
+
+    if (pos > literalStart)
+      compiled.segments.push_back({literalStart, pos - literalStart, -1});
+
+    CompiledTemplate::Slot slot;
+    if (keyStart > pos + 1)
+      slot.scope = src.substr(pos + 1, keyStart - pos - 2);
+    slot.colorKey = src.substr(keyStart, digitsEnd - keyStart);
+    slot.propertyName = src.substr(digitsEnd + 1, close - digitsEnd - 1);
+    slot.color = colorIndex(slot.colorKey);
+    slot.property = propertyIndex(slot.propertyName);
+    compiled.segments.push_back(
+        {pos, close + 1 - pos, static_cast<int>(compiled.slots.size())});
+    compiled.slots.push_back(move(slot));
+
+    literalStart = close + 1;
+    pos = src.find('{', literalStart);
   }
 
-  // Apply replacements in reverse order
-  sort(replacements.rbegin(), replacements.rend());
-  for (const auto &replacement : replacements) {
-    size_t pos = replacement.first;
-    size_t len = replacement.second.first;
-    string newValue = replacement.second.second;
+  if (literalStart < src.size())
+    compiled.segments.push_back(
+        {literalStart, src.size() - literalStart, -1});
+  return compiled;
+}
+
+namespace {
+struct TemplateCacheEntry {
+  fs::file_time_type mtime;
+  uintmax_t size;
+  shared_ptr<const CompiledTemplate> compiled;
+};
+
+mutex templateCacheMutex;
+unordered_map<string, TemplateCacheEntry> templateCache;
+} // namespace
+
+shared_ptr<const CompiledTemplate> loadCompiledTemplate(const string &path) {
+  error_code ec;
+  auto mtime = fs::last_write_time(path, ec);
+  if (ec)
+    return nullptr;
+  uintmax_t size = fs::file_size(path, ec);
+  if (ec)
+    return nullptr;
 
-    result.replace(pos, len, newValue);
+  {
+    lock_guard<mutex> lock(templateCacheMutex);
+    auto it = templateCache.find(path);
+    if (it != templateCache.end() && it->second.mtime == mtime &&
+        it->second.size == size)
+      return it->second.compiled;
   }
 
+  ifstream inputFile(path);
+  if (!inputFile.is_open())
+    return nullptr;
+  string content((istreambuf_iterator<char>(inputFile)),
+                 istreambuf_iterator<char>());
+
+  auto compiled = make_shared<const CompiledTemplate>(compileTemplate(content));
+  lock_guard<mutex> lock(templateCacheMutex);
+  templateCache[path] = {mtime, size, compiled};
+  return compiled;
+}
+
+PaletteValues::PaletteValues(const json &colorJson) : colorJson(colorJson) {
+  const auto &properties = templateProperties();
+  for (const auto &item : colorJson.items()) {
+    int index = colorIndex(item.key());
+    if (index < 0 || index > 4096)
+      continue;
+    if (index >= static_cast<int>(values.size())) {
+      values.resize(index + 1, vector<string>(properties.size()));
+      present.resize(index + 1, vector<bool>(properties.size(), false));
+    }
+    for (size_t p = 0; p < properties.size(); ++p) {
+      present[index][p] = lookupPlaceholder(colorJson, item.key(),
+                                            properties[p], values[index][p]);
+    }
+  }
+
+  auto regionJson = colorJson.find("regions");
+  if (regionJson != colorJson.end() && regionJson->is_object()) {
+    for (const auto &region : regionJson->items()) {
+      if (region.value().is_object())
+        regions[region.key()] = make_unique<PaletteValues>(region.value());
+    }
+  }
+}
+
+// Value of `slot` in `palette` (or its region), or nullptr if it has none.
+static const string *resolveSlot(const CompiledTemplate::Slot &slot,
+                                 const PaletteValues &palette,
+                                 string &fallback) {
+  const PaletteValues *values = &palette;
+  if (!slot.scope.empty()) {
+    auto region = palette.regions.find(slot.scope);
+    if (region == palette.regions.end())
+      return nullptr;
+    values = region->second.get();
+  }
+
+  if (slot.color >= 0 && slot.property >= 0 &&
+      slot.color < static_cast<int>(values->values.size()) &&
+      values->present[slot.color][slot.property])
+    return &values->values[slot.color][slot.property];
+  if (lookupPlaceholder(values->colorJson, slot.colorKey, slot.propertyName,
+                        fallback))
+    return &fallback;
+  return nullptr;
+}
+
+string renderTemplate(const CompiledTemplate &compiled,
+                      const PaletteValues &palette) {
+  // Resolve every slot first so the output can be sized exactly.
+  vector<const string *> resolved(compiled.slots.size(), nullptr);
+  vector<string> fallback(compiled.slots.size());
+  for (size_t i = 0; i < compiled.slots.size(); ++i) {
+    const auto &slot = compiled.slots[i];
+    resolved[i] = resolveSlot(slot, palette, fallback[i]);
+    if (!resolved[i]) {
+      cerr << "Warning: Color placeholder not found: {"
+           << (slot.scope.empty() ? "" : slot.scope + ".") << slot.colorKey
+           << "." << slot.propertyName << "}" << endl;
+    }
+  }
+
+  size_t total = 0;
+  for (const auto &segment : compiled.segments) {
+    total += segment.slot >= 0 && resolved[segment.slot]
+                 ? resolved[segment.slot]->size()
+                 : segment.length;
+  }
+
+  string result;
+  result.reserve(total);
+  for (const auto &segment : compiled.segments) {
+    if (segment.slot >= 0 && resolved[segment.slot])
+      result += *resolved[segment.slot];
+    else
+      result.append(compiled.source, segment.offset, segment.length);
+  }
   return result;
 }
+
+string replaceColorPlaceholders(const string &content, const json &colorJson) {
+  return renderTemplate(compileTemplate(content), PaletteValues(colorJson));
+}
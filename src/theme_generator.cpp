@@ -0,0 +1,157 @@
+#include "theme_generator.hpp"
+#include "file_utils.hpp"
+#include "palette_file.hpp"
+#include "profiler.hpp"
+#include <chrono>
+#include <cstdlib>
+
+using namespace std;
+using namespace cv;
+
+ThemePaths defaultThemePaths() {
+  const char *home = getenv("HOME");
+  string base = string(home ? home : ".") + "/.config/huegen/";
+  return {base + "templates/", base + "themes/"};
+}
+
+size_t ThemeRun::changedCount() const {
+  return count_if(templates.begin(), templates.end(),
+                  [](const TemplateResult &r) { return r.changed; });
+}
+
+bool obtainPalette(const string &imagePath, const ExtractOptions &opts,
+                   PaletteCache *cache, vector<Vec3f> &palette, bool &cached,
+                   vector<RegionPalette> *regions,
+                   vector<VariantPalette> *variants) {
+  if (variants && !opts.variants.empty()) {
+    cached = false;
+    if (!extractVariantPalettesFromFile(imagePath, opts, palette, *variants)) {
+      cerr << "Failed to load image: " << imagePath << "\n";
+      return false;
+    }
+    return true;
+  }
+  if (regions && !opts.regions.empty()) {
+    cached = false;
+    if (!extractRegionPalettesFromFile(imagePath, opts, palette, *regions)) {
+      cerr << "Failed to load image: " << imagePath << "\n";
+      return false;
+    }
+    return true;
+  }
+
+  string cacheKey;
+  {
+    profiler::Stage stage("paletteCache");
+    cacheKey = cache ? cache->keyFor(imagePath, opts) : "";
+    cached = !cacheKey.empty() && cache->lookup(cacheKey, palette);
+  }
+  if (cached)
+    return true;
+
+  if (!extractPaletteFromFile(imagePath, opts, palette)) {
+    cerr << "Failed to load image: " << imagePath << "\n";
+    return false;
+  }
+  if (!cacheKey.empty())
+    cache->store(cacheKey, palette);
+  return true;
+}
+
+// colors.bin entries for the first paletteFileEntries colors of `palette`.
+static vector<PaletteFileEntry> paletteFileEntriesFor(
+    const vector<Vec3f> &palette) {
+  size_t count = min<size_t>(palette.size(), paletteFileEntries);
+  vector<Vec3b> rgb(count);
+  vector<Vec3f> hsl(count), hsv(count);
+  labToRgbBatch(palette.data(), rgb.data(), count);
+  rgbToHslHsvBatch(rgb.data(), hsl.data(), hsv.data(), count);
+
+  vector<PaletteFileEntry> entries(count);
+  for (size_t i = 0; i < count; ++i) {
+    PaletteFileEntry &entry = entries[i];
+    for (int c = 0; c < 3; ++c) {
+      entry.rgb[c] = rgb[i][c];
+      entry.lab[c] = palette[i][c];
+      entry.hsl[c] = hsl[i][c];
+      entry.hsv[c] = hsv[i][c];
+    }
+    entry.rgb[3] = 255;
+  }
+  return entries;
+}
+
+json themeColorsJson(const vector<Vec3f> &palette,
+                     const vector<RegionPalette> &regions) {
+  json colorJson = colorsToJson(palette);
+  for (const RegionPalette &region : regions)
+    colorJson["regions"][region.name] = colorsToJson(region.colors);
+  return colorJson;
+}
+
+ThemePaths variantThemePaths(const ThemePaths &paths, const string &name) {
+  return {paths.templateDir, paths.outputDir + name + "/"};
+}
+
+ThemeRun writeThemes(const vector<Vec3f> &palette, const ThemePaths &paths,
+                     const vector<RegionPalette> &regions,
+                     const vector<VariantPalette> &variants) {
+  ThemeRun run;
+  json colorJson;
+  {
+    profiler::Stage stage("colorsToJson");
+    colorJson = themeColorsJson(palette, regions);
+  }
+
+  bool success;
+  {
+    profiler::Stage stage("processTemplates");
+    success = processTemplates(colorJson, paths.templateDir, paths.outputDir,
+                               &run.templates);
+  }
+  string outputFile = paths.outputDir + "colors.json";
+  // Pretty-print with 4-space indentation
+  if (writeFileAtomic(outputFile, colorJson.dump(4)) == WriteResult::Failed) {
+    cerr << "Error: Could not open file " << paths.outputDir << "\n";
+    return run;
+  }
+
+  // Binary twin of colors.json for consumers that mmap it
+  vector<PaletteFileEntry> entries = paletteFileEntriesFor(palette);
+  if (!writePaletteFile(paths.outputDir + "colors.bin", entries.data(),
+                        static_cast<uint16_t>(entries.size())))
+    return run;
+
+  // Templates stay compiled, so each variant is one more render pass.
+  for (const VariantPalette &variant : variants) {
+    ThemeRun variantRun =
+        writeThemes(variant.colors, variantThemePaths(paths, variant.name));
+    success = success && variantRun.ok;
+    for (TemplateResult &result : variantRun.templates) {
+      result.name = variant.name + "/" + result.name;
+      run.templates.push_back(move(result));
+    }
+  }
+
+  run.ok = success;
+  return run;
+}
+
+ThemeRun generateThemes(const string &imagePath, const ExtractOptions &opts,
+                        PaletteCache *cache, const ThemePaths &paths) {
+  auto start = chrono::steady_clock::now();
+
+  vector<Vec3f> palette;
+  vector<RegionPalette> regions;
+  vector<VariantPalette> variants;
+  bool cached = false;
+  ThemeRun run;
+  if (obtainPalette(imagePath, opts, cache, palette, cached, &regions,
+                    &variants))
+    run = writeThemes(palette, paths, regions, variants);
+  run.cached = cached;
+
+  run.seconds = chrono::duration<double>(chrono::steady_clock::now() - start)
+                    .count();
+  return run;
+}
@@ -0,0 +1,152 @@
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <opencv2/opencv.hpp>
+
+using namespace std;
+
+struct ThreadPool::Job {
+  const function<void(size_t)> *fn;
+  size_t count;
+  atomic<size_t> next{0};
+  unsigned seats;            // helper threads still allowed to join
+  unsigned active = 0;       // helpers currently running the job
+  exception_ptr error;       // first exception thrown by fn, under errorMutex
+  mutex errorMutex;
+};
+
+static thread_local bool insidePoolTask = false;
+
+// Marks the current thread as running pool tasks, so nested parallelFor
+// calls run inline, and restores the previous state on any exit.
+struct PoolTaskScope {
+  bool wasInside = insidePoolTask;
+  PoolTaskScope() { insidePoolTask = true; }
+  ~PoolTaskScope() { insidePoolTask = wasInside; }
+};
+
+ThreadPool::ThreadPool(unsigned threads) {
+  if (threads == 0)
+    threads = max(1u, thread::hardware_concurrency());
+  for (unsigned i = 1; i < threads; ++i)
+    workers_.emplace_back([this] { workerLoop(); });
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    lock_guard<mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  for (auto &w : workers_)
+    w.join();
+}
+
+ThreadPool &ThreadPool::shared() {
+  static ThreadPool pool;
+  return pool;
+}
+
+// A throwing fn stops the job: no further indices are handed out, and the
+// first exception is rethrown by parallelFor once every helper has left.
+void ThreadPool::runJob(Job &job) {
+  PoolTaskScope scope;
+  try {
+    for (size_t i = job.next++; i < job.count; i = job.next++)
+      (*job.fn)(i);
+  } catch (...) {
+    job.next = job.count;
+    lock_guard<mutex> lock(job.errorMutex);
+    if (!job.error)
+      job.error = current_exception();
+  }
+}
+
+void ThreadPool::workerLoop() {
+  size_t seen = 0;
+  unique_lock<mutex> lock(mutex_);
+  while (true) {
+    wake_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+    if (stopping_)
+      return;
+    seen = generation_;
+    Job *job = job_;
+    if (!job || job->seats == 0)
+      continue;
+    job->seats--;
+    job->active++;
+
+    lock.unlock();
+    runJob(*job);
+    lock.lock();
+
+    if (--job->active == 0)
+      done_.notify_all();
+  }
+}
+
+void ThreadPool::parallelFor(size_t count, const function<void(size_t)> &fn,
+                             unsigned maxWorkers) {
+  if (count == 0)
+    return;
+
+  unsigned helpers = static_cast<unsigned>(workers_.size());
+  if (maxWorkers > 0)
+    helpers = min(helpers, maxWorkers - 1);
+  helpers = static_cast<unsigned>(min<size_t>(helpers, count - 1));
+
+  if (helpers == 0 || insidePoolTask) {
+    for (size_t i = 0; i < count; ++i)
+      fn(i);
+    return;
+  }
+
+  // One job at a time; concurrent callers queue here.
+  lock_guard<mutex> submit(submitMutex_);
+  Job job;
+  job.fn = &fn;
+  job.count = count;
+  job.seats = helpers;
+  {
+    lock_guard<mutex> lock(mutex_);
+    job_ = &job;
+    generation_++;
+  }
+  wake_.notify_all();
+
+  runJob(job);
+
+  unique_lock<mutex> lock(mutex_);
+  // Close the job to helpers that have not picked it up yet, then wait for
+  // the ones that did.
+  job.seats = 0;
+  done_.wait(lock, [&] { return job.active == 0; });
+  job_ = nullptr;
+  lock.unlock();
+  if (job.error)
+    rethrow_exception(job.error);
+}
+
+// Shared by every SerialOpenCvScope, since setNumThreads() is process-wide.
+static mutex serialOpenCvMutex;
+static int serialOpenCvScopes = 0;
+static int savedOpenCvThreads = 0;
+
+SerialOpenCvScope::SerialOpenCvScope(bool active) : active_(active) {
+  if (!active_)
+    return;
+  lock_guard<mutex> lock(serialOpenCvMutex);
+  if (serialOpenCvScopes++ == 0) {
+    savedOpenCvThreads = cv::getNumThreads();
+    cv::setNumThreads(1);
+  }
+}
+
+SerialOpenCvScope::~SerialOpenCvScope() {
+  if (!active_)
+    return;
+  lock_guard<mutex> lock(serialOpenCvMutex);
+  if (--serialOpenCvScopes == 0)
+    cv::setNumThreads(savedOpenCvThreads);
+}
@@ -0,0 +1,106 @@
+#include "tiled_pipeline.hpp"
+#include "color_histogram.hpp"
+#include "minibatch_kmeans.hpp"
+#include "preprocess.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <atomic>
+
+using namespace std;
+using namespace cv;
+
+namespace {
+
+// Per-worker buffers, reused for every tile the worker processes.
+struct TileScratch {
+  Mat bgrFloat;
+  Mat lab;
+  LabSoA points;
+  vector<int> labels;
+};
+
+void processTile(const Mat &tile, const vector<Vec3f> &centers,
+                 TileScratch &scratch, ColorHistogram &histogram) {
+  tile.convertTo(scratch.bgrFloat, CV_32F, 1.0 / 255.0);
+  cvtColor(scratch.bgrFloat, scratch.lab, COLOR_BGR2Lab);
+
+  size_t n = tile.total();
+  scratch.points.l.resize(n);
+  scratch.points.a.resize(n);
+  scratch.points.b.resize(n);
+  scratch.labels.resize(n);
+  size_t i = 0;
+  for (int row = 0; row < scratch.lab.rows; ++row) {
+    const Vec3f *pixel = scratch.lab.ptr<Vec3f>(row);
+    for (int col = 0; col < scratch.lab.cols; ++col, ++i) {
+      scratch.points.l[i] = pixel[col][0];
+      scratch.points.a[i] = pixel[col][1];
+      scratch.points.b[i] = pixel[col][2];
+    }
+  }
+
+  assignNearest(scratch.points, centers, scratch.labels.data());
+
+  i = 0;
+  for (int row = 0; row < scratch.lab.rows; ++row) {
+    const Vec3f *pixel = scratch.lab.ptr<Vec3f>(row);
+    for (int col = 0; col < scratch.lab.cols; ++col, ++i)
+      histogram.add(
+          clusterColorKey(scratch.labels[i], quantizeLab(pixel[col])));
+  }
+}
+
+} // namespace
+
+vector<Vec3f> extractTiledColors(const Mat &bgr, int k,
+                                 const TileParams &params) {
+  if (bgr.empty() || k <= 0)
+    return {};
+
+  // Train the centers on a small copy; the full-resolution pass only
+  // assigns and counts.
+  Mat seed = downsampleToBudget(bgr, params.seedBudget);
+  Mat seedLab;
+  seed.convertTo(seed, CV_32F, 1.0 / 255.0);
+  cvtColor(seed, seedLab, COLOR_BGR2Lab);
+  MiniBatchParams training;
+  training.seed = params.seed;
+  vector<Vec3f> centers =
+      miniBatchKMeans(LabSoA::fromMat(seedLab), k, training).centers;
+  if (centers.empty())
+    return {};
+
+  int tileSize = max(8, params.tileSize);
+  int tilesX = (bgr.cols + tileSize - 1) / tileSize;
+  int tilesY = (bgr.rows + tileSize - 1) / tileSize;
+  size_t tileCount = static_cast<size_t>(tilesX) * tilesY;
+
+  ThreadPool &pool = ThreadPool::shared();
+  unsigned workers = params.threads ? params.threads : pool.size();
+  workers = static_cast<unsigned>(min<size_t>(workers, tileCount));
+
+  vector<ColorHistogram> partial(workers, ColorHistogram(1 << 14));
+  atomic<size_t> nextTile{0};
+
+  // The pool already runs one worker per core; OpenCV's own threads would
+  // only compete with it on these small tiles.
+  SerialOpenCvScope serialOpenCv;
+  pool.parallelFor(
+      workers,
+      [&](size_t worker) {
+        TileScratch scratch;
+        size_t t;
+        while ((t = nextTile.fetch_add(1, memory_order_relaxed)) < tileCount) {
+          int x = static_cast<int>(t % tilesX) * tileSize;
+          int y = static_cast<int>(t / tilesX) * tileSize;
+          Rect area(x, y, min(tileSize, bgr.cols - x),
+                    min(tileSize, bgr.rows - y));
+          processTile(bgr(area), centers, scratch, partial[worker]);
+        }
+      },
+      workers);
+
+  for (unsigned w = 1; w < workers; ++w)
+    partial[0].merge(partial[w]);
+  return histogramModes(partial[0], k);
+}
@@ -0,0 +1,188 @@
+#include "video_stream.hpp"
+#include "color_utils.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <nlohmann/json.hpp>
+#include <tuple>
+
+using namespace std;
+using namespace cv;
+using json = nlohmann::json;
+
+namespace {
+
+// Animated images carry no frame rate OpenCV exposes; GIFs are commonly
+// authored around this.
+const double defaultImageFps = 10.0;
+
+// Pages decoded per imreadmulti call when VideoCapture cannot open a file.
+const int pagesPerChunk = 8;
+
+// Sequential frame source over either a VideoCapture or chunked imreadmulti
+// reads, holding at most one chunk of pages.
+class FrameReader {
+public:
+  bool open(const string &path) {
+    path_ = path;
+    if (capture_.open(path) && capture_.isOpened()) {
+      double fps = capture_.get(CAP_PROP_FPS);
+      fps_ = fps > 0 ? fps : defaultImageFps;
+      return true;
+    }
+    try {
+      pageCount_ = static_cast<int>(imcount(path));
+    } catch (const exception &) {
+      pageCount_ = 0;
+    }
+    fps_ = defaultImageFps;
+    return pageCount_ > 0;
+  }
+
+  double fps() const { return fps_; }
+
+  // Advances one frame. The pixels are only decoded into `frame` when
+  // `decode` is set; skipped video frames are grabbed but never converted.
+  bool next(Mat &frame, bool decode) {
+    if (capture_.isOpened()) {
+      if (!capture_.grab())
+        return false;
+      return !decode || capture_.retrieve(frame);
+    }
+
+    if (nextPage_ >= pageCount_)
+      return false;
+    if (nextPage_ >= chunkStart_ + static_cast<int>(pages_.size())) {
+      pages_.clear();
+      chunkStart_ = nextPage_;
+      int count = min(pagesPerChunk, pageCount_ - nextPage_);
+      if (!imreadmulti(path_, pages_, chunkStart_, count, IMREAD_COLOR) ||
+          pages_.empty())
+        return false;
+    }
+    if (decode)
+      frame = pages_[nextPage_ - chunkStart_];
+    nextPage_++;
+    return true;
+  }
+
+private:
+  string path_;
+  VideoCapture capture_;
+  vector<Mat> pages_;
+  int pageCount_ = 0;
+  int chunkStart_ = 0;
+  int nextPage_ = 0;
+  double fps_ = defaultImageFps;
+};
+
+json timelineEntry(long frameIndex, double seconds,
+                   const vector<Vec3f> &palette) {
+  vector<Vec3b> rgb(palette.size());
+  labToRgbBatch(palette.data(), rgb.data(), palette.size());
+
+  json colors = json::array();
+  char buffer[kColorStringCapacity];
+  for (const Vec3b &color : rgb)
+    colors.push_back(string(buffer, formatHexTo(buffer, color)));
+  return {{"frame", frameIndex}, {"time", seconds}, {"colors", colors}};
+}
+
+} // namespace
+
+void blendPalettes(vector<Vec3f> &smoothed, const vector<Vec3f> &frame,
+                   float weight) {
+  if (smoothed.empty()) {
+    smoothed = frame;
+    return;
+  }
+
+  // Greedy matching: closest pairs first, each color used at most once.
+  vector<tuple<float, size_t, size_t>> pairs;
+  pairs.reserve(smoothed.size() * frame.size());
+  for (size_t s = 0; s < smoothed.size(); ++s) {
+    for (size_t f = 0; f < frame.size(); ++f)
+      pairs.emplace_back(colorDistance(smoothed[s], frame[f]), s, f);
+  }
+  sort(pairs.begin(), pairs.end());
+
+  vector<bool> smoothedUsed(smoothed.size(), false);
+  vector<bool> frameUsed(frame.size(), false);
+  for (const auto &pair : pairs) {
+    size_t s = get<1>(pair), f = get<2>(pair);
+    if (smoothedUsed[s] || frameUsed[f])
+      continue;
+    smoothedUsed[s] = frameUsed[f] = true;
+    Vec3f delta = frame[f] - smoothed[s];
+    smoothed[s] += delta * weight;
+  }
+  for (size_t f = 0; f < frame.size(); ++f) {
+    if (!frameUsed[f])
+      smoothed.push_back(frame[f]);
+  }
+
+  sort(smoothed.begin(), smoothed.end(), [](const Vec3f &a, const Vec3f &b) {
+    return calculateSaturation(a) > calculateSaturation(b);
+  });
+}
+
+StreamReport extractStreamPalette(const string &path,
+                                  const ExtractOptions &opts,
+                                  const StreamOptions &stream,
+                                  vector<Vec3f> &smoothed) {
+  StreamReport report;
+  smoothed.clear();
+
+  FrameReader reader;
+  if (!reader.open(path)) {
+    cerr << "Error: Could not open video or image: " << path << endl;
+    return report;
+  }
+
+  ofstream timeline;
+  if (!stream.timelinePath.empty()) {
+    timeline.open(stream.timelinePath);
+    if (!timeline.is_open()) {
+      cerr << "Error: Could not open file " << stream.timelinePath << endl;
+      return report;
+    }
+  }
+
+  long step = 1;
+  if (stream.sampleFps > 0)
+    step = max(1L, lround(reader.fps() / stream.sampleFps));
+  float weight = min(max(stream.smoothing, 0.0f), 1.0f);
+
+  auto start = chrono::steady_clock::now();
+  vector<Vec3f> centers;
+  Mat frame;
+  for (long index = 0;; ++index) {
+    bool sampled = index % step == 0;
+    bool read;
+    {
+      profiler::Stage stage("decodeFrame");
+      read = reader.next(frame, sampled);
+    }
+    if (!read)
+      break;
+    report.framesDecoded++;
+    if (!sampled || frame.empty())
+      continue;
+
+    vector<Vec3f> palette = extractFramePalette(frame, opts, centers);
+    blendPalettes(smoothed, palette, weight);
+    report.framesSampled++;
+
+    if (timeline.is_open())
+      timeline << timelineEntry(index, index / reader.fps(), palette).dump()
+               << "\n";
+  }
+  auto end = chrono::steady_clock::now();
+
+  report.seconds = chrono::duration<double>(end - start).count();
+  report.ok = report.framesSampled > 0;
+  return report;
+}
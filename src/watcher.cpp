@@ -0,0 +1,276 @@
+#include "watcher.hpp"
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <poll.h>
+#include <set>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace cv;
+namespace fs = std::filesystem;
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void handleStopSignal(int) { stopRequested = 1; }
+
+namespace {
+
+const uint32_t imageEvents = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE;
+const uint32_t templateEvents =
+    IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE;
+
+// A file of interest, identified by its directory watch and its name.
+// Watching directories rather than files survives editors and `ln -sf`
+// replacing the file instead of rewriting it.
+struct WatchedName {
+  int wd = -1;
+  string name;
+};
+
+class Watcher {
+public:
+  Watcher(const string &imagePath, const ExtractOptions &opts,
+          PaletteCache *cache, const ThemePaths &paths, HookDispatcher *hooks)
+      : imagePath_(fs::absolute(imagePath).string()), opts_(opts),
+        cache_(cache), paths_(paths), hooks_(hooks) {}
+
+  ~Watcher() {
+    if (fd_ >= 0)
+      close(fd_);
+  }
+
+  bool start() {
+    fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd_ < 0) {
+      cerr << "inotify_init1 failed: " << strerror(errno) << "\n";
+      return false;
+    }
+
+    templateWd_ = addWatch(paths_.templateDir, templateEvents);
+    if (templateWd_ < 0)
+      return false;
+    fs::path image(imagePath_);
+    link_.name = image.filename().string();
+    link_.wd = addWatch(image.parent_path().string(), imageEvents);
+    if (link_.wd < 0)
+      return false;
+    watchTarget();
+    return true;
+  }
+
+  int fd() const { return fd_; }
+
+  // Drains the queued events. Returns false on a read error.
+  bool readEvents() {
+    alignas(inotify_event) char buffer[8192];
+    while (true) {
+      ssize_t n = read(fd_, buffer, sizeof(buffer));
+      if (n < 0) {
+        if (errno == EINTR)
+          continue;
+        return errno == EAGAIN;
+      }
+      if (n == 0)
+        return true;
+
+      for (char *p = buffer; p < buffer + n;) {
+        auto *event = reinterpret_cast<inotify_event *>(p);
+        handleEvent(event->wd, event->mask, event->len ? event->name : "");
+        p += sizeof(inotify_event) + event->len;
+      }
+    }
+  }
+
+  bool pending() const { return imageChanged_ || !changedTemplates_.empty(); }
+
+  void flush() {
+    if (imageChanged_) {
+      regenerate();
+      // A full render already picked up any template edits.
+      changedTemplates_.clear();
+      imageChanged_ = false;
+      return;
+    }
+    rerenderTemplates();
+    changedTemplates_.clear();
+  }
+
+  // Re-extracts the palette and renders every template.
+  void regenerate() {
+    auto start = chrono::steady_clock::now();
+    bool cached = false;
+    if (!obtainPalette(imagePath_, opts_, cache_, palette_, cached,
+                       &regions_, &variants_))
+      return;
+    ThemeRun run = writeThemes(palette_, paths_, regions_, variants_);
+    if (hooks_)
+      hooks_->dispatch(run.templates);
+    // Adds only this regeneration's lookups to the stored totals.
+    if (cache_)
+      cache_->persistStats();
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() -
+                                                start)
+                    .count();
+    cout << "Wallpaper " << imagePath_ << ": " << run.changedCount() << " of "
+         << run.templates.size() << " themes changed in " << ms << " ms"
+         << (cached ? " (cached palette)" : "") << endl;
+    watchTarget();
+  }
+
+private:
+  int addWatch(const string &dir, uint32_t mask) {
+    // IN_MASK_ADD keeps both masks when the image lives in the template
+    // directory, or the link and its target share a directory.
+    int wd = inotify_add_watch(fd_, dir.c_str(), mask | IN_MASK_ADD);
+    if (wd < 0)
+      cerr << "Cannot watch " << dir << ": " << strerror(errno) << "\n";
+    return wd;
+  }
+
+  // When the image is a symlink, also watch the file it currently points
+  // to, so rewriting the wallpaper in place is noticed.
+  void watchTarget() {
+    error_code ec;
+    fs::path target;
+    if (fs::is_symlink(imagePath_, ec))
+      target = fs::canonical(imagePath_, ec);
+    if (ec || target.empty()) {
+      unwatchTarget();
+      return;
+    }
+
+    int wd = addWatch(target.parent_path().string(), imageEvents);
+    if (wd != target_.wd)
+      unwatchTarget();
+    target_ = wd >= 0 ? WatchedName{wd, target.filename().string()}
+                      : WatchedName();
+  }
+
+  void unwatchTarget() {
+    // Directory watches are shared, so keep the ones still in use.
+    if (target_.wd >= 0 && target_.wd != link_.wd && target_.wd != templateWd_)
+      inotify_rm_watch(fd_, target_.wd);
+    target_ = WatchedName();
+  }
+
+  void handleEvent(int wd, uint32_t mask, const string &name) {
+    // The kernel dropped events, so any file may have changed unseen.
+    if (mask & IN_Q_OVERFLOW) {
+      cerr << "inotify queue overflowed; regenerating everything" << endl;
+      imageChanged_ = true;
+      return;
+    }
+    if ((wd == link_.wd && name == link_.name) ||
+        (wd == target_.wd && name == target_.name))
+      imageChanged_ = true;
+    if (wd == templateWd_ && fs::path(name).extension() == ".tlp")
+      changedTemplates_.insert(name);
+  }
+
+  // Renders the changed templates into `outputDir`, naming results with
+  // `prefix` the way writeThemes() does. A template that no longer exists
+  // (deleted or renamed away) takes its rendered output with it.
+  void rerenderInto(const json &colorJson, const string &outputDir,
+                    const string &prefix, vector<TemplateResult> &results) {
+    PaletteValues values(colorJson);
+    for (const string &name : changedTemplates_) {
+      fs::path templatePath = fs::path(paths_.templateDir) / name;
+      if (!fs::exists(templatePath)) {
+        fs::path output = fs::path(outputDir) / templatePath.stem();
+        error_code ec;
+        if (fs::remove(output, ec))
+          cout << "Template removed: " << prefix + name << ", deleted "
+               << output.string() << endl;
+        continue;
+      }
+      TemplateResult result =
+          processTemplate(templatePath.string(), outputDir, values);
+      result.name = prefix + result.name;
+      if (!result.ok) {
+        cerr << "Error: Could not process template: " << result.name << endl;
+      } else {
+        cout << "Re-rendered: " << result.name
+             << (result.changed ? "" : " (unchanged)") << endl;
+      }
+      results.push_back(result);
+    }
+  }
+
+  void rerenderTemplates() {
+    if (palette_.empty())
+      return;
+    vector<TemplateResult> results;
+    rerenderInto(themeColorsJson(palette_, regions_), paths_.outputDir, "",
+                 results);
+    for (const VariantPalette &variant : variants_)
+      rerenderInto(colorsToJson(variant.colors),
+                   variantThemePaths(paths_, variant.name).outputDir,
+                   variant.name + "/", results);
+    if (hooks_)
+      hooks_->dispatch(results);
+  }
+
+  string imagePath_;
+  const ExtractOptions &opts_;
+  PaletteCache *cache_;
+  const ThemePaths &paths_;
+  HookDispatcher *hooks_;
+
+  int fd_ = -1;
+  int templateWd_ = -1;
+  WatchedName link_;
+  WatchedName target_;
+
+  vector<Vec3f> palette_;
+  vector<RegionPalette> regions_;
+  vector<VariantPalette> variants_;
+  bool imageChanged_ = false;
+  set<string> changedTemplates_;
+};
+
+} // namespace
+
+int runWatch(const string &imagePath, const ExtractOptions &opts,
+             PaletteCache *cache, const ThemePaths &paths, int debounceMs,
+             HookDispatcher *hooks) {
+  Watcher watcher(imagePath, opts, cache, paths, hooks);
+  if (!watcher.start())
+    return 1;
+
+  // No SA_RESTART: a signal must interrupt poll() so the loop can exit.
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = handleStopSignal;
+  sigaction(SIGINT, &action, nullptr);
+  sigaction(SIGTERM, &action, nullptr);
+
+  watcher.regenerate();
+  cout << "Watching " << imagePath << " and " << paths.templateDir << endl;
+
+  while (!stopRequested) {
+    // Block until something happens; once events are pending, wait for a
+    // quiet period of debounceMs before acting on them.
+    pollfd pfd = {watcher.fd(), POLLIN, 0};
+    int ready = poll(&pfd, 1, watcher.pending() ? debounceMs : -1);
+    if (ready < 0) {
+      if (errno == EINTR)
+        continue;
+      cerr << "poll failed: " << strerror(errno) << "\n";
+      return 1;
+    }
+    if (ready == 0) {
+      watcher.flush();
+      continue;
+    }
+    if (!watcher.readEvents()) {
+      cerr << "Reading inotify events failed: " << strerror(errno) << "\n";
+      return 1;
+    }
+  }
+  return 0;
+}
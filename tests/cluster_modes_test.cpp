@@ -0,0 +1,103 @@
+#include "kmeans_wrapper.hpp"
+#include "test_common.hpp"
+#include <map>
+#include <random>
+
+using namespace std;
+using namespace cv;
+
+// The per-cluster std::map scan clusterModes() replaced; its output is the
+// contract: each cluster's most frequent quantized color, ties going to the
+// smallest (L, a, b), empty clusters skipped.
+static vector<Vec3f> referenceModes(const Mat &lab, const Mat &labels, int k) {
+  auto vec3fCompare = [](const Vec3f &a, const Vec3f &b) {
+    if (a[0] != b[0])
+      return a[0] < b[0];
+    if (a[1] != b[1])
+      return a[1] < b[1];
+    return a[2] < b[2];
+  };
+
+  vector<Vec3f> allColors;
+  for (int cluster = 0; cluster < k; ++cluster) {
+    map<Vec3f, int, decltype(vec3fCompare)> colorCount(vec3fCompare);
+    for (int i = 0; i < labels.rows; ++i) {
+      if (labels.at<int>(i, 0) == cluster) {
+        Vec3f labColor = lab.at<Vec3f>(i / lab.cols, i % lab.cols);
+        labColor[0] = round(labColor[0]);
+        labColor[1] = round(labColor[1] * 2) / 2.0f;
+        labColor[2] = round(labColor[2] * 2) / 2.0f;
+        colorCount[labColor]++;
+      }
+    }
+
+    Vec3f mostFrequent;
+    int maxCount = 0;
+    for (const auto &pair : colorCount) {
+      if (pair.second > maxCount) {
+        maxCount = pair.second;
+        mostFrequent = pair.first;
+      }
+    }
+    if (maxCount > 0)
+      allColors.push_back(mostFrequent);
+  }
+  return allColors;
+}
+
+static void compare(const vector<Vec3f> &pixels, const vector<int> &clusters,
+                    int k, const string &what) {
+  Mat lab(1, static_cast<int>(pixels.size()), CV_32FC3);
+  Mat labels(static_cast<int>(pixels.size()), 1, CV_32S);
+  for (size_t i = 0; i < pixels.size(); ++i) {
+    lab.at<Vec3f>(0, static_cast<int>(i)) = pixels[i];
+    labels.at<int>(static_cast<int>(i), 0) = clusters[i];
+  }
+  vector<Vec3f> expected = referenceModes(lab, labels, k);
+  vector<Vec3f> actual = clusterModes(lab, labels, k);
+  bool same = expected.size() == actual.size();
+  for (size_t i = 0; same && i < expected.size(); ++i)
+    same = expected[i] == actual[i];
+  expect(same, what);
+}
+
+int main() {
+  // Two colors with the same count: the smaller (L, a, b) wins, whichever
+  // comes first in the image.
+  compare({{50, 10, 10}, {40, 10, 10}, {50, 10, 10}, {40, 10, 10}},
+          {0, 0, 0, 0}, 1, "tie on L");
+  compare({{40, 10, 5}, {40, -10, 5}, {40, -10, 5}, {40, 10, 5}},
+          {0, 0, 0, 0}, 1, "tie on negative a");
+  compare({{40, 3, 5.5f}, {40, 3, -5.5f}}, {0, 0}, 1, "tie on b");
+  // Values that round to the same quantized color, including half-units.
+  compare({{49.6f, 0.24f, -0.26f}, {50.4f, 0.1f, -0.5f}, {30, 0, 0}},
+          {0, 0, 0}, 1, "rounding into one bin");
+  compare({{20.5f, 0.25f, -0.25f}, {21, 0.5f, -0.5f}, {21.4f, 0.3f, -0.4f}},
+          {0, 0, 0}, 1, "half-unit boundaries");
+  // Empty clusters are skipped, non-empty ones keep cluster order.
+  compare({{10, 0, 0}, {90, 0, 0}, {60, 5, 5}}, {3, 1, 3}, 5,
+          "empty clusters");
+
+  // Few distinct colors over many pixels: frequent ties in every cluster.
+  mt19937 rng(7);
+  for (int round = 0; round < 50; ++round) {
+    int k = 1 + round % 8;
+    uniform_int_distribution<int> palette(0, 11), cluster(0, k - 1);
+    uniform_real_distribution<float> jitter(-0.3f, 0.3f);
+    vector<Vec3f> colors(12);
+    for (int i = 0; i < 12; ++i)
+      colors[i] = Vec3f(static_cast<float>(i * 7 % 100), i * 3.5f - 20.0f,
+                        20.0f - i * 2.5f);
+    vector<Vec3f> pixels;
+    vector<int> clusters;
+    for (int i = 0; i < 40 + round * 20; ++i) {
+      Vec3f c = colors[palette(rng)];
+      if (round % 2)
+        c += Vec3f(jitter(rng), jitter(rng), jitter(rng));
+      pixels.push_back(c);
+      clusters.push_back(cluster(rng));
+    }
+    compare(pixels, clusters, k, "seeded round " + to_string(round));
+  }
+  return failures() != 0;
+}
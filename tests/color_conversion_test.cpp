@@ -0,0 +1,207 @@
+#include "color_utils.hpp"
+#include "template_engine.hpp"
+#include "test_common.hpp"
+#include <iomanip>
+#include <sstream>
+
+using namespace std;
+using namespace cv;
+
+// The per-color path the batched kernels replaced, kept verbatim: a 1x1
+// cvtColor per color, branchy HSL/HSV and stringstream/to_string output.
+static Vec3b oldLabToBgr(Vec3f labColor) {
+  Mat lab(1, 1, CV_32FC3, Scalar(labColor[0], labColor[1], labColor[2]));
+  Mat bgr;
+  cvtColor(lab, bgr, COLOR_Lab2BGR);
+  bgr.convertTo(bgr, CV_8UC3, 255.0);
+  return bgr.at<Vec3b>(0, 0);
+}
+
+static Vec3f oldRgbToHsl(const Vec3b &rgbColor) {
+  float r = rgbColor[0] / 255.0f;
+  float g = rgbColor[1] / 255.0f;
+  float b = rgbColor[2] / 255.0f;
+
+  float max_val = max({r, g, b});
+  float min_val = min({r, g, b});
+  float delta = max_val - min_val;
+
+  float h = 0, s = 0, l = (max_val + min_val) / 2.0f;
+
+  if (delta != 0) {
+    s = (l > 0.5f) ? delta / (2.0f - max_val - min_val)
+                   : delta / (max_val + min_val);
+
+    if (max_val == r) {
+      h = ((g - b) / delta) + (g < b ? 6 : 0);
+    } else if (max_val == g) {
+      h = (b - r) / delta + 2;
+    } else {
+      h = (r - g) / delta + 4;
+    }
+    h /= 6.0f;
+  }
+
+  return Vec3f(h * 360.0f, s * 100.0f, l * 100.0f);
+}
+
+static Vec3f oldRgbToHsv(const Vec3b &rgbColor) {
+  float r = rgbColor[0] / 255.0f;
+  float g = rgbColor[1] / 255.0f;
+  float b = rgbColor[2] / 255.0f;
+
+  float max_val = max({r, g, b});
+  float min_val = min({r, g, b});
+  float delta = max_val - min_val;
+
+  float h = 0, s = 0, v = max_val;
+
+  if (max_val != 0) {
+    s = delta / max_val;
+  }
+
+  if (delta != 0) {
+    if (max_val == r) {
+      h = ((g - b) / delta) + (g < b ? 6 : 0);
+    } else if (max_val == g) {
+      h = (b - r) / delta + 2;
+    } else {
+      h = (r - g) / delta + 4;
+    }
+    h /= 6.0f;
+  }
+
+  return Vec3f(h * 360.0f, s * 100.0f, v * 100.0f);
+}
+
+static string oldStrip(const Vec3b &rgbColor) {
+  stringstream ss;
+  ss << hex << uppercase << setfill('0') << setw(2) << (int)rgbColor[0]
+     << setw(2) << (int)rgbColor[1] << setw(2) << (int)rgbColor[2];
+  return ss.str();
+}
+
+static json oldColorsToJson(const vector<Vec3f> &labColors) {
+  json result = json::object();
+  for (size_t i = 0; i < labColors.size(); ++i) {
+    const Vec3f &labColor = labColors[i];
+    Vec3b rgbColor = bgrToRgb(oldLabToBgr(labColor));
+    Vec3f hslColor = oldRgbToHsl(rgbColor);
+    Vec3f hsvColor = oldRgbToHsv(rgbColor);
+    string rgb = to_string(rgbColor[0]) + ", " + to_string(rgbColor[1]) +
+                 ", " + to_string(rgbColor[2]);
+    result["color" + to_string(i)] = {
+        {"hex", "#" + oldStrip(rgbColor)},
+        {"strip", oldStrip(rgbColor)},
+        {"rgb", "rgb(" + rgb + ")"},
+        {"rgba", "rgba(" + rgb + ", 1.0)"},
+        {"hsl", "hsl(" + to_string((int)round(hslColor[0])) + ", " +
+                    to_string((int)round(hslColor[1])) + "%, " +
+                    to_string((int)round(hslColor[2])) + "%)"},
+        {"hsv", "hsv(" + to_string((int)round(hsvColor[0])) + ", " +
+                    to_string((int)round(hsvColor[1])) + "%, " +
+                    to_string((int)round(hsvColor[2])) + "%)"},
+        {"lab", "lab(" + to_string((int)round(labColor[0])) + ", " +
+                    to_string((int)round(labColor[1])) + ", " +
+                    to_string((int)round(labColor[2])) + ")"}};
+  }
+  return result;
+}
+
+static string describe(const Vec3f &lab) {
+  return "lab(" + to_string(lab[0]) + ", " + to_string(lab[1]) + ", " +
+         to_string(lab[2]) + ")";
+}
+
+static string describe(const Vec3b &rgb) {
+  return "rgb(" + to_string(rgb[0]) + ", " + to_string(rgb[1]) + ", " +
+         to_string(rgb[2]) + ")";
+}
+
+// Lab grid covering the gamut and beyond it (clamped channels), in steps
+// that are not multiples of the quantization so rounding is exercised.
+static vector<Vec3f> labGrid() {
+  vector<Vec3f> grid;
+  for (float l = 0.0f; l <= 100.0f; l += 2.5f)
+    for (float a = -128.0f; a <= 127.0f; a += 3.7f)
+      for (float b = -128.0f; b <= 127.0f; b += 3.7f)
+        grid.push_back(Vec3f(l, a, b));
+  return grid;
+}
+
+static void checkLabToRgb(const vector<Vec3f> &grid) {
+  vector<Vec3b> rgb(grid.size());
+  labToRgbBatch(grid.data(), rgb.data(), grid.size());
+  for (size_t i = 0; i < grid.size(); ++i) {
+    Vec3b expected = bgrToRgb(oldLabToBgr(grid[i]));
+    if (!expect(rgb[i] == expected, "labToRgbBatch at " + describe(grid[i])) ||
+        !expect(labToBgr(grid[i]) == bgrToRgb(expected),
+                "labToBgr at " + describe(grid[i])))
+      return;
+  }
+}
+
+// Every eighth level per channel plus 255, so gray, the primaries and
+// each max-channel branch are all hit.
+static void checkHslHsv() {
+  vector<Vec3b> rgb;
+  for (int r = 0; r <= 256; r += 8)
+    for (int g = 0; g <= 256; g += 8)
+      for (int b = 0; b <= 256; b += 8)
+        rgb.push_back(Vec3b(min(r, 255), min(g, 255), min(b, 255)));
+
+  vector<Vec3f> hsl(rgb.size()), hsv(rgb.size());
+  rgbToHslHsvBatch(rgb.data(), hsl.data(), hsv.data(), rgb.size());
+  for (size_t i = 0; i < rgb.size(); ++i) {
+    if (!expect(hsl[i] == oldRgbToHsl(rgb[i]), "HSL of " + describe(rgb[i])) ||
+        !expect(hsv[i] == oldRgbToHsv(rgb[i]), "HSV of " + describe(rgb[i])))
+      return;
+  }
+}
+
+static void checkFormatters() {
+  char buffer[kColorStringCapacity];
+  for (int v = 0; v < 256; ++v) {
+    Vec3b rgb(v, 255 - v, (v * 37) % 256);
+    string stripped = oldStrip(rgb);
+    if (!expect(string(buffer, formatHexTo(buffer, rgb)) == "#" + stripped,
+                "formatHexTo of " + describe(rgb)) ||
+        !expect(string(buffer, formatHexTo(buffer, rgb, false)) == stripped,
+                "formatHexTo without hash of " + describe(rgb)))
+      return;
+  }
+
+  const int samples[][3] = {{0, 0, 0},     {255, 87, 51},     {360, 100, 100},
+                            {-128, 0, 127}, {-1, -10, -100},   {7, 42, 999}};
+  for (const auto &values : samples) {
+    string x = to_string(values[0]), y = to_string(values[1]),
+           z = to_string(values[2]);
+    string lab(buffer, formatColorFunctionTo(buffer, "lab", values));
+    expect(lab == "lab(" + x + ", " + y + ", " + z + ")",
+           "formatColorFunctionTo: " + lab);
+    string hsla(buffer, formatColorFunctionTo(buffer, "hsla", values, "%",
+                                              ", 1.0)"));
+    expect(hsla == "hsla(" + x + ", " + y + "%, " + z + "%, 1.0)",
+           "formatColorFunctionTo: " + hsla);
+  }
+}
+
+// colorsToJson() as a whole, one 16-color palette at a time as in a run.
+static void checkColorsToJson(const vector<Vec3f> &grid) {
+  for (size_t start = 0; start < grid.size(); start += 16) {
+    vector<Vec3f> palette(grid.begin() + start,
+                          grid.begin() + min(start + 16, grid.size()));
+    if (!expect(colorsToJson(palette) == oldColorsToJson(palette),
+                "colorsToJson from " + describe(palette.front())))
+      return;
+  }
+}
+
+int main() {
+  vector<Vec3f> grid = labGrid();
+  checkLabToRgb(grid);
+  checkHslHsv();
+  checkFormatters();
+  checkColorsToJson(grid);
+  return failures() != 0;
+}
@@ -0,0 +1,107 @@
+#include "color_selector.hpp"
+#include "color_utils.hpp"
+#include "test_common.hpp"
+#include <cfloat>
+#include <functional>
+#include <random>
+
+using namespace std;
+using namespace cv;
+
+// The O(n·k²) selection the incremental sampler replaced: every round
+// recomputes each remaining candidate's distance to every selected color.
+// `distance` takes indices into `colors`.
+static vector<size_t>
+referenceSelect(const vector<Vec3f> &colors, int n,
+                const function<float(size_t, size_t)> &distance) {
+  if (colors.empty())
+    return {};
+
+  vector<size_t> selected;
+  vector<size_t> remaining(colors.size());
+  for (size_t i = 0; i < remaining.size(); ++i)
+    remaining[i] = i;
+
+  auto maxSatIt = max_element(
+      remaining.begin(), remaining.end(), [&](size_t a, size_t b) {
+        return calculateSaturation(colors[a]) < calculateSaturation(colors[b]);
+      });
+  selected.push_back(*maxSatIt);
+  remaining.erase(maxSatIt);
+
+  while (selected.size() < static_cast<size_t>(n) && !remaining.empty()) {
+    size_t bestIndex = 0;
+    float maxMinDistance = 0.0f;
+
+    for (size_t i = 0; i < remaining.size(); ++i) {
+      float minDist = FLT_MAX;
+      for (size_t s : selected)
+        minDist = min(minDist, distance(remaining[i], s));
+      if (minDist > maxMinDistance) {
+        maxMinDistance = minDist;
+        bestIndex = i;
+      }
+    }
+
+    selected.push_back(remaining[bestIndex]);
+    remaining.erase(remaining.begin() + bestIndex);
+  }
+  return selected;
+}
+
+static vector<Vec3f> pick(const vector<Vec3f> &colors,
+                          const vector<size_t> &indices) {
+  vector<Vec3f> picked;
+  for (size_t i : indices)
+    picked.push_back(colors[i]);
+  return picked;
+}
+
+static void compare(const vector<Vec3f> &colors, int n, const string &what) {
+  vector<size_t> expected =
+      referenceSelect(colors, n, [&](size_t i, size_t j) {
+        return colorDistance(colors[i], colors[j]);
+      });
+  expect(selectMostDistinctColors(colors, n) == pick(colors, expected),
+         what + " (direct)");
+
+  for (DistanceMetric metric :
+       {DistanceMetric::CIE76, DistanceMetric::CIEDE2000,
+        DistanceMetric::CAM16UCS}) {
+    DistanceMatrix distances(colors, metric);
+    vector<size_t> fromMatrix = referenceSelect(
+        colors, n, [&](size_t i, size_t j) { return distances(i, j); });
+    expect(selectMostDistinctColors(colors, n, distances) ==
+               pick(colors, fromMatrix),
+           what + " (" + distanceMetricName(metric) + ")");
+  }
+}
+
+int main() {
+  compare({}, 4, "no candidates");
+  compare({{50, 20, 20}}, 4, "single candidate");
+  // Duplicates and equidistant candidates: the earliest one wins a tie.
+  compare({{50, 0, 0}, {50, 0, 0}, {50, 0, 0}}, 3, "all identical");
+  compare({{50, 40, 0}, {50, -40, 0}, {50, 0, 40}, {50, 0, -40}, {50, 0, 0}},
+          5, "equidistant ring");
+  compare({{20, 10, 10}, {80, 10, 10}, {20, 10, 10}, {80, 10, 10}}, 4,
+          "duplicated pairs");
+  compare({{60, 30, 30}, {40, 5, 5}}, 8, "n above the candidate count");
+
+  // Seeded candidates on a coarse grid, so distance ties are common.
+  mt19937 rng(11);
+  uniform_int_distribution<int> lightness(0, 10), chroma(-8, 8);
+  for (int round = 0; round < 100; ++round) {
+    vector<Vec3f> colors;
+    int count = 2 + round % 40;
+    for (int i = 0; i < count; ++i) {
+      Vec3f c(lightness(rng) * 10.0f, chroma(rng) * 10.0f,
+              chroma(rng) * 10.0f);
+      if (round % 3 == 0)
+        c += Vec3f(0.37f * i, -0.11f * i, 0.05f * i);
+      colors.push_back(c);
+    }
+    compare(colors, 1 + round % 17, "seeded round " + to_string(round));
+  }
+  return failures() != 0;
+}
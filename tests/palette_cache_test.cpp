@@ -0,0 +1,106 @@
+#include "palette_cache.hpp"
+#include <filesystem>
+#include <iostream>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace cv;
+namespace fs = std::filesystem;
+
+static bool expectTotals(pair<size_t, size_t> totals, size_t hits,
+                         size_t misses, const char *what) {
+  if (totals.first == hits && totals.second == misses)
+    return true;
+  cerr << what << ": expected " << hits << " hits, " << misses
+       << " misses; got " << totals.first << ", " << totals.second << "\n";
+  return false;
+}
+
+static size_t countEntries(const string &directory) {
+  size_t count = 0;
+  for (const auto &entry : fs::directory_iterator(directory)) {
+    if (entry.path().extension() == ".json" &&
+        entry.path().filename() != "stats.json")
+      count++;
+  }
+  return count;
+}
+
+// Eviction keeps the directory within the limit, dropping the oldest
+// palettes, also for entries that were there before this instance.
+static bool checkEviction(const string &directory) {
+  vector<Vec3f> palette = {Vec3f(50, 10, -10)}, loaded;
+  {
+    PaletteCache earlier(directory, 8);
+    for (int i = 0; i < 4; ++i)
+      earlier.store("old" + to_string(i), palette);
+  }
+  PaletteCache cache(directory, 8);
+  for (int i = 0; i < 20; ++i)
+    cache.store("new" + to_string(i), palette);
+
+  bool ok = true;
+  if (countEntries(directory) > 8) {
+    cerr << "eviction: " << countEntries(directory) << " entries, limit 8\n";
+    ok = false;
+  }
+  if (!cache.lookup("new19", loaded)) {
+    cerr << "eviction: the newest palette was evicted\n";
+    ok = false;
+  }
+  return ok;
+}
+
+// Processes persisting at the same time must not lose each other's counts.
+static bool checkConcurrentProcesses(const string &directory) {
+  const int processes = 8, rounds = 25;
+  for (int p = 0; p < processes; ++p) {
+    if (fork() == 0) {
+      PaletteCache cache(directory);
+      vector<Vec3f> loaded;
+      for (int r = 0; r < rounds; ++r) {
+        cache.lookup("missing", loaded);
+        cache.persistStats();
+      }
+      _exit(0);
+    }
+  }
+  while (wait(nullptr) > 0) {
+  }
+  return expectTotals(PaletteCache(directory).persistStats(), 0,
+                      processes * rounds, "concurrent processes");
+}
+
+int main() {
+  string directory = (fs::temp_directory_path() /
+                      ("huegen-cache-test-" + to_string(getpid())))
+                         .string();
+  // persistStats() must add only what happened since the previous call, as
+  // the daemon and the watcher call it after every request.
+  bool ok = true;
+  {
+    PaletteCache cache(directory);
+    vector<Vec3f> palette = {Vec3f(50, 10, -10)}, loaded;
+    cache.store("entry", palette);
+
+    cache.lookup("entry", loaded);
+    ok &= expectTotals(cache.persistStats(), 1, 0, "first call");
+    cache.lookup("entry", loaded);
+    cache.lookup("missing", loaded);
+    ok &= expectTotals(cache.persistStats(), 2, 1, "second call");
+    ok &= expectTotals(cache.persistStats(), 2, 1, "call without lookups");
+
+    // A second process adds to the same totals.
+    PaletteCache other(directory);
+    other.lookup("entry", loaded);
+    ok &= expectTotals(other.persistStats(), 3, 1, "second instance");
+  }
+  error_code ec;
+  fs::remove_all(directory, ec);
+  ok &= checkEviction(directory);
+  fs::remove_all(directory, ec);
+  ok &= checkConcurrentProcesses(directory);
+  fs::remove_all(directory, ec);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,127 @@
+#include "template_engine.hpp"
+#include "test_common.hpp"
+#include <regex>
+
+// The std::regex renderer the compiled templates replaced, extended with the
+// optional region scope: {colorN.property} or {region.colorN.property}.
+// Region names are [a-z0-9_-] and never start with "color".
+static bool referenceLookup(const json &colorJson, const string &colorKey,
+                            const string &property, string &replacement) {
+  if (!colorJson.contains(colorKey) || !colorJson[colorKey].is_object() ||
+      !colorJson[colorKey].contains(property))
+    return false;
+  const json &value = colorJson[colorKey][property];
+  replacement.clear();
+  if (value.is_string())
+    replacement = value.get<string>();
+  else if (value.is_number())
+    replacement = to_string(value.get<double>());
+  else if (value.is_object())
+    replacement = value.dump();
+  return true;
+}
+
+static string referenceRender(const string &content, const json &colorJson) {
+  static const regex pattern(
+      R"(\{(?:(?!color)([a-z0-9_-]+)\.)?(color\d+)\.([^}]+)\})");
+  string result;
+  size_t last = 0;
+  for (sregex_iterator it(content.begin(), content.end(), pattern), end;
+       it != end; ++it) {
+    const smatch &match = *it;
+    const json *palette = &colorJson;
+    if (match[1].matched) {
+      auto regions = colorJson.find("regions");
+      palette = nullptr;
+      if (regions != colorJson.end() && regions->contains(match[1].str()) &&
+          (*regions)[match[1].str()].is_object())
+        palette = &(*regions)[match[1].str()];
+    }
+
+    string replacement;
+    result.append(content, last, match.position() - last);
+    if (palette &&
+        referenceLookup(*palette, match[2].str(), match[3].str(), replacement))
+      result += replacement;
+    else
+      result += match.str();
+    last = match.position() + match.length();
+  }
+  result.append(content, last, string::npos);
+  return result;
+}
+
+static json testPalette() {
+  vector<Vec3f> colors, top, center;
+  for (int i = 0; i < 16; ++i) {
+    colors.push_back(
+        Vec3f(5.0f + i * 6.0f, i * 9.0f - 70.0f, 60.0f - i * 7.5f));
+    top.push_back(Vec3f(90.0f - i * 5.0f, i * 3.0f, -i * 4.0f));
+  }
+  center.push_back(Vec3f(50, 20, -20));
+
+  json colorJson = colorsToJson(colors);
+  // Non-string values take the fallback lookup path.
+  colorJson["color3"]["weight"] = 1.5;
+  colorJson["color3"]["channels"] = {{"r", 1}, {"g", 2}};
+  colorJson["regions"] = {{"top", colorsToJson(top)},
+                          {"center", colorsToJson(center)}};
+  return colorJson;
+}
+
+static void compare(const string &content, const json &colorJson,
+                    const PaletteValues &values, const string &what) {
+  // Unknown placeholders are reported on stderr; keep the test output to
+  // the failures.
+  streambuf *saved = cerr.rdbuf(nullptr);
+  string expected = referenceRender(content, colorJson);
+  string compiled = renderTemplate(compileTemplate(content), values);
+  string direct = replaceColorPlaceholders(content, colorJson);
+  cerr.rdbuf(saved);
+  expect(compiled == expected, what + " (compiled)");
+  expect(direct == expected, what + " (replaceColorPlaceholders)");
+}
+
+int main() {
+  json colorJson = testPalette();
+  PaletteValues values(colorJson);
+
+  size_t shipped = 0;
+  for (const auto &entry :
+       fs::directory_iterator(string(HUEGEN_SOURCE_DIR) + "/templates")) {
+    if (entry.path().extension() != ".tlp")
+      continue;
+    ifstream file(entry.path(), ios::binary);
+    string content((istreambuf_iterator<char>(file)),
+                   istreambuf_iterator<char>());
+    compare(content, colorJson, values, entry.path().filename().string());
+
+    auto cached = loadCompiledTemplate(entry.path().string());
+    expect(cached && renderTemplate(*cached, values) ==
+                         referenceRender(content, colorJson),
+           entry.path().filename().string() + " (cached)");
+    shipped++;
+  }
+  expect(shipped > 0, "no shipped templates found");
+
+  const vector<pair<string, string>> cases = {
+      {"{color0.hex}{color1.strip}{color15.rgba}", "adjacent placeholders"},
+      {"#{color2.strip}{{color3.hex}}}", "placeholders inside braces"},
+      {"{color16.hex} {color99.rgb} {color1.nope}", "unknown keys"},
+      {"{color01.hex} {color.hex} {color1.} {colorx.hex}", "not placeholders"},
+      {"{color3.weight} {color3.channels}", "number and object values"},
+      {"{color1.he{color2.hex}", "property running into a brace"},
+      {"{top.color0.hex}{center.color0.rgb}{top.color15.hsl}",
+       "region placeholders"},
+      {"{top.color16.hex} {bottom.color0.hex} {center.color1.hex}",
+       "unknown region keys"},
+      {"{Top.color0.hex} {top.{color1.hex} {top.}", "malformed region scopes"},
+      {"{top.color2.hex}{color2.hex}{center.color0.strip}",
+       "regions next to the main palette"},
+      {"unterminated {color1.hex", "unterminated placeholder"},
+      {"", "empty template"},
+  };
+  for (const auto &c : cases)
+    compare(c.first, colorJson, values, c.second);
+  return failures() != 0;
+}
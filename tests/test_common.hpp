@@ -0,0 +1,22 @@
+#ifndef TEST_COMMON_HPP
+#define TEST_COMMON_HPP
+
+#include <iostream>
+#include <string>
+
+// Shared by the tests/ executables: each check reports what failed on
+// stderr, and main() returns failures() != 0.
+inline int &failures() {
+  static int count = 0;
+  return count;
+}
+
+inline bool expect(bool condition, const std::string &what) {
+  if (!condition) {
+    std::cerr << "FAILED: " << what << "\n";
+    failures()++;
+  }
+  return condition;
+}
+
+#endif
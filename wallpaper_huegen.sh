@@ -38,16 +38,41 @@ swww img "$SELECTED_WALLPAPER" \
   --transition-duration="$TRANSITION_DURATION" \
   --transition-pos "$CURSOR_POS"
 
-~/.binary/heugen ~/.wallpaper.png
-cat ~/.config/mako/base.conf ~/.config/huegen/themes/colors-mako.conf >~/.config/mako/config
-makoctl reload
+# Prefer a resident `heugen --daemon`; status 2 means none is listening.
+~/.binary/heugen --client ~/.wallpaper.png
+if [[ $? -eq 2 ]]; then
+  ~/.binary/heugen ~/.wallpaper.png
+fi
+# True when ~/.config/huegen/hooks.conf has a hook whose glob matches the
+# theme $1. heugen runs those hooks itself, so the built-in reload for that
+# theme is skipped; every other built-in reload still runs.
+hooked() {
+  local hooks="$HOME/.config/huegen/hooks.conf" pattern
+  [[ -f "$hooks" ]] || return 1
+  while IFS=: read -r pattern _; do
+    pattern="${pattern#"${pattern%%[![:space:]]*}"}"
+    pattern="${pattern%"${pattern##*[![:space:]]}"}"
+    [[ -z "$pattern" || "$pattern" == \#* ]] && continue
+    [[ "$1" == $pattern ]] && return 0
+  done <"$hooks"
+  return 1
+}
 
-sleep 0.5
-pkill -SIGUSR2 waybar
+if ! hooked colors-mako.conf; then
+  cat ~/.config/mako/base.conf ~/.config/huegen/themes/colors-mako.conf >~/.config/mako/config
+  makoctl reload
+fi
 
-ps -t $(who | awk '{print $2}') -o pid=,comm= | grep -E 'zsh|bash' | awk '{print $1}' | while read pid; do
-  kill -USR1 "$pid"
-done
+if ! hooked waybar.css; then
+  sleep 0.5
+  pkill -SIGUSR2 waybar
+fi
+
+if ! hooked termcol.sh; then
+  ps -t $(who | awk '{print $2}') -o pid=,comm= | grep -E 'zsh|bash' | awk '{print $1}' | while read pid; do
+    kill -USR1 "$pid"
+  done
+fi
 
 for i in {0..7}; do
   printf "\e[48;5;${i}m   \e[0m" # 8 spaces wide